@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "common.h"
+#include "layout.h"
+
+double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void board_to_grid(const board_t *board, grid_t grid)
+{
+	int i;
+
+	memset(grid, 0, sizeof(grid_t));
+	for(i = 0; i < board->layout->slot_count; ++i)
+		grid[board->layout->y[i]][board->layout->x[i]][board->layout->z[i]] = board_chip(board, i);
+}
+
+static chip_t safe_get(const grid_t grid, int y, int x, int k)
+{
+	if(y < 0 || y >= MAX_ROW_COUNT)
+		return 0;
+	if(x < 0 || x >= MAX_COL_COUNT)
+		return 0;
+	if(k < 0 || k >= MAX_HEIGHT)
+		return 0;
+
+	return grid[y][x][k];
+}
+
+static int column_height(const grid_t grid, int y, int x)
+{
+	int k;
+
+	for(k = MAX_HEIGHT-1; k >= 0; --k)
+		if(grid[y][x][k])
+			return k + 1;
+	return 0;
+}
+
+static int scan_selectable(const grid_t grid, int y, int x)
+{
+	int i, j;
+	int h = column_height(grid, y, x);
+	int l, r;
+
+	if(h == 0 || (safe_get(grid, y, x, h - 1) & CHIP_CATEGORY_MASK) == CHIP_CATEGORY_BLOCK)
+		return 0;
+
+	for(i = -1; i <= 1; ++i)
+		for(j = -1; j <= 1; ++j)
+			if(safe_get(grid, y+i, x+j, h) != 0)
+				return 0;
+
+	l = safe_get(grid, y-1, x-2, h-1)
+		|| safe_get(grid, y, x-2, h-1)
+		|| safe_get(grid, y+1, x-2, h-1);
+
+	r = safe_get(grid, y-1, x+2, h-1)
+		|| safe_get(grid, y, x+2, h-1)
+		|| safe_get(grid, y+1, x+2, h-1);
+
+	if(l && r)
+		return 0;
+
+	return h;
+}
+
+void scan_selectable_positions(const grid_t grid, positions_t *positions)
+{
+	int i, j;
+
+	positions->count = 0;
+	for(i = 0; i < MAX_ROW_COUNT; ++i) {
+		for(j = 0; j < MAX_COL_COUNT; ++j) {
+			int h = scan_selectable(grid, i, j);
+			if(h) {
+				positions->positions[positions->count].y = i;
+				positions->positions[positions->count].x = j;
+				positions->positions[positions->count].z = h - 1;
+				++positions->count;
+			}
+		}
+	}
+}
+
+static int cmp_pos(const void *p1, const void *p2)
+{
+	const position_t *pos1 = p1;
+	const position_t *pos2 = p2;
+	return
+		((pos1->y * MAX_COL_COUNT + pos1->x) * MAX_HEIGHT + pos1->z) -
+		((pos2->y * MAX_COL_COUNT + pos2->x) * MAX_HEIGHT + pos2->z);
+}
+
+int same_positions(positions_t *a, positions_t *b)
+{
+	int i;
+
+	if(a->count != b->count)
+		return 0;
+	qsort(a->positions, a->count, sizeof(position_t), cmp_pos);
+	qsort(b->positions, b->count, sizeof(position_t), cmp_pos);
+	for(i = 0; i < a->count; ++i)
+		if(!position_equal(&a->positions[i], &b->positions[i]))
+			return 0;
+	return 1;
+}
+
+int record_game(map_t *map, board_t *states, int *moves)
+{
+	int count = 0;
+	board_t board;
+
+	generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, NULL);
+	for(;;) {
+		move_t legal[MAX_MOVE_COUNT];
+		const int legal_count = board_moves(&board, legal, MAX_MOVE_COUNT);
+
+		states[count] = board;
+		++count;
+		if(legal_count == 0)
+			return count;
+
+		const move_t *move = &legal[rrand(legal_count)];
+		moves[2 * (count - 1)] = move->slot1;
+		moves[2 * (count - 1) + 1] = move->slot2;
+		board_remove_chip(&board, move->slot1);
+		board_remove_chip(&board, move->slot2);
+	}
+}
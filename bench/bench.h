@@ -0,0 +1,26 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "board.h"
+
+double bench_now(void);
+
+/* The board representation before layouts, one chip per grid cell */
+typedef chip_t grid_t[MAX_ROW_COUNT][MAX_COL_COUNT][MAX_HEIGHT];
+
+void board_to_grid(const board_t *board, grid_t grid);
+
+/* The original selectability rules, scanning every cell of the grid */
+void scan_selectable_positions(const grid_t grid, positions_t *positions);
+
+/* Compares two position sets regardless of order, sorts both */
+int same_positions(positions_t *a, positions_t *b);
+
+/*
+	Plays a random game on a freshly generated board, recording the state
+	before every move and the slots of every move. Returns the number of
+	states, the last one has no moves left.
+*/
+int record_game(map_t *map, board_t *states, int *moves);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+	Share of winnable positions the beam search finds a line for within a
+	time budget, against what the exact solver says about the same
+	positions. The positions are new deals and partly played games on the
+	built-in maps. Every line found has to clear the board, and no line
+	may be found for a position the exact solver proved lost.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "maps.h"
+#include "beam.h"
+#include "solver.h"
+#include "bench.h"
+
+#define DEALS 40 /* Per map */
+#define SOLVER_NODES 2000000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+static const double budgets[] = { 0.001, 0.005, 0.02, 0.1, 0.5 };
+
+#define BUDGET_COUNT ((int) (sizeof(budgets) / sizeof(budgets[0])))
+
+typedef struct {
+	board_t board;
+	int winnable; /* By the exact solver */
+} sample_t;
+
+static int check_line(const board_t *position, const move_t *line)
+{
+	int k, j;
+	board_t board = *position;
+
+	for(k = 0; k < position->tile_count / 2; ++k) {
+		move_t moves[MAX_MOVE_COUNT];
+		const int count = board_moves(&board, moves, MAX_MOVE_COUNT);
+
+		for(j = 0; j < count; ++j)
+			if(moves[j].slot1 == line[k].slot1 && moves[j].slot2 == line[k].slot2)
+				break;
+		if(j == count)
+			return 0;
+		board_remove_chip(&board, line[k].slot1);
+		board_remove_chip(&board, line[k].slot2);
+	}
+	return board.tile_count == 0;
+}
+
+/* New deals and games with a few random moves played, which are lost as often as not */
+static int make_corpus(map_t *map, sample_t *corpus, solver_t *solver)
+{
+	int i, k;
+	int count = 0;
+	rng_t rng;
+
+	rng_seed(&rng, rrand_u32());
+	for(i = 0; i < DEALS; ++i) {
+		board_t board;
+		const int moves_played = i % 2 ? 4 + rng_range(&rng, 12) : 0;
+		int result;
+
+		generate_board(&board, map, rng_next(&rng), DIFFICULTY_NORMAL, NULL, NULL);
+		for(k = 0; k < moves_played; ++k) {
+			move_t moves[MAX_MOVE_COUNT];
+			const int move_count = board_moves(&board, moves, MAX_MOVE_COUNT);
+			const move_t *move;
+
+			if(move_count == 0)
+				break;
+			move = &moves[rng_range(&rng, move_count)];
+			board_remove_chip(&board, move->slot1);
+			board_remove_chip(&board, move->slot2);
+		}
+
+		result = solve_board(solver, &board, &solver_limits, NULL, NULL);
+		if(result == SOLVER_UNKNOWN)
+			continue;
+		corpus[count].board = board;
+		corpus[count].winnable = result;
+		++count;
+	}
+	return count;
+}
+
+static void bench_map(map_t *map, solver_t *solver)
+{
+	int i, b;
+	int winnable = 0;
+	sample_t *corpus = malloc(sizeof(sample_t) * DEALS);
+	const int count = make_corpus(map, corpus, solver);
+
+	for(i = 0; i < count; ++i)
+		winnable += corpus[i].winnable;
+
+	for(b = 0; b < BUDGET_COUNT; ++b) {
+		int found = 0, lost = 0;
+		double t = 0, worst = 0;
+		beam_limits_t limits = beam_default_limits;
+
+		limits.time_limit = budgets[b];
+		for(i = 0; i < count; ++i) {
+			move_t line[MAX_CHIP_COUNT / 2];
+			beam_stats_t stats;
+			const int result = solve_board_beam(&corpus[i].board, &limits, line, &stats);
+
+			if(result == 1 && (!corpus[i].winnable || !check_line(&corpus[i].board, line))) {
+				printf("%s: position %d got a wrong line\n", map->name, i);
+				exit(1);
+			}
+			if(result == 0 && corpus[i].winnable) {
+				printf("%s: position %d is winnable but was called lost\n", map->name, i);
+				exit(1);
+			}
+			found += result == 1;
+			lost += result == 0;
+			t += stats.seconds;
+			if(stats.seconds > worst)
+				worst = stats.seconds;
+		}
+
+		printf("%-14s budget %6.1f ms  lines found %3d of %3d winnable (%5.1f%%), lost proven %2d of %2d  mean %7.2f ms, worst %7.2f ms\n",
+			map->name, budgets[b] * 1e3,
+			found, winnable, winnable ? found * 100.0 / winnable : 0,
+			lost, count - winnable,
+			count ? t * 1e3 / count : 0, worst * 1e3);
+	}
+	free(corpus);
+}
+
+int main(int argc, char **argv)
+{
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	printf("Beam memory %u KB\n", (unsigned int) (beam_default_limits.memory / 1024));
+	bench_map(&standard_map, solver);
+	bench_map(&difficult_map, solver);
+	bench_map(&four_bridges_map, solver);
+	solver_free(solver);
+	return 0;
+}
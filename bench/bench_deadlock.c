@@ -0,0 +1,174 @@
+/*
+	Cost of the static deadlock check, in full and after a move, and how
+	early it sees random games lost, on the built-in maps. Every position
+	along each game is checked, both ways have to agree. Once a game is
+	called lost it has to stay lost and must not be won, and
+	the first position called lost is searched exhaustively without the
+	check when it has few enough tiles left, which must not find a win.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "maps.h"
+#include "bench.h"
+
+#define GAMES 300 /* Per map */
+#define REPEAT 20 /* Checks per position, for the timing */
+#define PROOF_TILES 72 /* Positions with more tiles left are not searched */
+#define PROOF_NODES 2000000
+#define LOST_BITS 18 /* Lost positions remembered by the proof search */
+
+/* Plain search for a win, remembering lost positions, without board_deadlocked() */
+typedef struct {
+	board_state_t *lost;
+	unsigned char *used;
+	long nodes;
+} proof_t;
+
+static int proof_seen(proof_t *proof, const board_state_t *state, int add)
+{
+	const unsigned int mask = (1u << LOST_BITS) - 1;
+	unsigned int i = board_state_hash(state) & mask;
+	int probes;
+
+	for(probes = 0; probes < 64; ++probes, i = (i + 1) & mask) {
+		if(!proof->used[i]) {
+			if(add) {
+				proof->used[i] = 1;
+				proof->lost[i] = *state;
+			}
+			return 0;
+		}
+		if(!memcmp(&proof->lost[i], state, sizeof(board_state_t)))
+			return 1;
+	}
+	return 0;
+}
+
+/* Returns 1 if won, 0 if lost, -1 if out of nodes */
+static int prove(proof_t *proof, board_t *board)
+{
+	int i, count;
+	int result = 0;
+	move_t moves[MAX_MOVE_COUNT];
+
+	if(board->tile_count == 0)
+		return 1;
+	if(proof_seen(proof, &board->state, 0))
+		return 0;
+	if(++proof->nodes > PROOF_NODES)
+		return -1;
+
+	count = board_moves(board, moves, MAX_MOVE_COUNT);
+	for(i = 0; i < count && result == 0; ++i) {
+		board_remove_chip(board, moves[i].slot1);
+		board_remove_chip(board, moves[i].slot2);
+		result = prove(proof, board);
+		board_restore_chip(board, moves[i].slot2, board->chip[moves[i].slot2]);
+		board_restore_chip(board, moves[i].slot1, board->chip[moves[i].slot1]);
+	}
+	if(result == 0)
+		proof_seen(proof, &board->state, 1);
+	return result;
+}
+
+static void bench_map(map_t *map, proof_t *proof)
+{
+	int game, i, r;
+	int moves[MAX_CHIP_COUNT];
+	board_t *states = malloc(sizeof(board_t) * (MAX_CHIP_COUNT / 2 + 1));
+	long positions = 0;
+	int lost = 0, seen = 0, proven = 0, unproven = 0;
+	long moves_early = 0;
+	double t = 0, t_move = 0;
+
+	for(game = 0; game < GAMES; ++game) {
+		const int count = record_game(map, states, moves);
+		int first = -1;
+		double t0;
+		volatile int sink = 0;
+
+		t0 = bench_now();
+		for(i = 0; i < count; ++i)
+			for(r = 0; r < REPEAT; ++r)
+				sink += board_deadlocked(&states[i]);
+		t += bench_now() - t0;
+		t0 = bench_now();
+		for(i = 1; i < count; ++i) {
+			const move_t move = { moves[2 * (i - 1)], moves[2 * (i - 1) + 1] };
+			for(r = 0; r < REPEAT; ++r)
+				sink += board_deadlocked_by(&states[i], &move);
+		}
+		t_move += bench_now() - t0;
+		positions += count;
+
+		for(i = 0; i < count; ++i) {
+			const int deadlocked = board_deadlocked(&states[i]);
+
+			if(i > 0 && first < 0) {
+				const move_t move = { moves[2 * (i - 1)], moves[2 * (i - 1) + 1] };
+				if(board_deadlocked_by(&states[i], &move) != deadlocked) {
+					printf("%s: game %d, move %d is called %s after the move only\n", map->name, game, i, deadlocked ? "not lost" : "lost");
+					exit(1);
+				}
+			}
+
+			if(first < 0 && deadlocked)
+				first = i;
+			if(first >= 0 && !deadlocked) {
+				printf("%s: game %d was called lost at move %d but not at move %d\n", map->name, game, first, i);
+				exit(1);
+			}
+		}
+		if(states[count - 1].tile_count == 0) {
+			if(first >= 0) {
+				printf("%s: game %d was called lost at move %d and then won\n", map->name, game, first);
+				exit(1);
+			}
+			continue;
+		}
+
+		++lost;
+		if(first < 0)
+			continue;
+		++seen;
+		moves_early += count - 1 - first;
+
+		if(states[first].tile_count <= PROOF_TILES) {
+			board_t board = states[first];
+
+			memset(proof->used, 0, 1u << LOST_BITS);
+			proof->nodes = 0;
+			switch(prove(proof, &board)) {
+				case 1:
+					printf("%s: game %d was called lost at move %d, which can be won\n", map->name, game, first);
+					exit(1);
+				case 0: ++proven; break;
+				default: ++unproven; break;
+			}
+		}
+	}
+
+	printf("%-14s %6ld positions  %5.2f us per check, %5.2f us after a move  lost games seen %3d of %3d (%5.1f%%), %5.1f moves before getting stuck  proven %d, out of nodes %d\n",
+		map->name, positions, t * 1e6 / (positions * REPEAT), t_move * 1e6 / ((positions - GAMES) * REPEAT),
+		seen, lost, lost ? seen * 100.0 / lost : 0, seen ? (double) moves_early / seen : 0,
+		proven, unproven);
+	free(states);
+}
+
+int main(int argc, char **argv)
+{
+	proof_t proof;
+
+	proof.lost = malloc(sizeof(board_state_t) << LOST_BITS);
+	proof.used = malloc(1u << LOST_BITS);
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	bench_map(&standard_map, &proof);
+	bench_map(&difficult_map, &proof);
+	bench_map(&four_bridges_map, &proof);
+	free(proof.lost);
+	free(proof.used);
+	return 0;
+}
@@ -0,0 +1,89 @@
+/*
+	Deals of each difficulty target, rated by how many random games on
+	them are won and how many tiles those games leave, with the time it
+	took to deal them. Every deal is checked to be solvable and to come
+	out the same again from its deal ID.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "rater.h"
+#include "solver.h"
+#include "bench.h"
+
+#define DEALS 50
+#define RATING_GAMES 200
+#define SOLVER_NODES 20000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+static const char *difficulty_name[DIFFICULTY_COUNT] = { "normal", "easy", "hard" };
+
+static void check_deal(map_t *map, board_t *board, solver_t *solver, const generator_stats_t *stats, int difficulty, int i)
+{
+	char text[DEAL_ID_LENGTH + 1];
+	deal_id_t id = make_deal_id(map, stats->seed, difficulty);
+	deal_id_t parsed;
+	board_t replay;
+
+	deal_id_format(&id, text);
+	if(!deal_id_parse(text, &parsed) || parsed.difficulty != difficulty || !generate_deal(&replay, map, &parsed)
+		|| memcmp(replay.chip, board->chip, board->layout->slot_count)) {
+		printf("%s: %s deal %d (%s) comes out differently the second time\n", map->name, difficulty_name[difficulty], i, text);
+		exit(1);
+	}
+	if(solve_board(solver, board, &solver_limits, NULL, NULL) == 0) {
+		printf("%s: %s deal %d cannot be solved\n", map->name, difficulty_name[difficulty], i);
+		exit(1);
+	}
+}
+
+static void bench_map(map_t *map)
+{
+	int i, difficulty;
+	board_t board;
+	rating_t rating;
+	generator_stats_t stats;
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+
+	for(difficulty = 0; difficulty < DIFFICULTY_COUNT; ++difficulty) {
+		int won = 0;
+		double tiles_left = 0;
+		double t = 0, worst = 0;
+
+		for(i = 0; i < DEALS; ++i) {
+			if(!generate_board(&board, map, rrand_u32(), difficulty, NULL, &stats)) {
+				printf("%s: no %s deal found\n", map->name, difficulty_name[difficulty]);
+				exit(1);
+			}
+			check_deal(map, &board, solver, &stats, difficulty, i);
+			t += stats.seconds;
+			if(stats.seconds > worst)
+				worst = stats.seconds;
+			rate_board(&board, RATER_RANDOM, RATING_GAMES, 1, rrand_u32(), &rating);
+			won += rating.won;
+			tiles_left += rating.tiles_left;
+		}
+
+		printf("%-14s %-6s  deal %7.1f us (worst %7.1f us)  random games won %5.1f%%, tiles left %5.1f\n",
+			map->name, difficulty_name[difficulty],
+			t * 1e6 / DEALS, worst * 1e6,
+			won * 100.0 / (DEALS * RATING_GAMES), tiles_left / DEALS);
+	}
+
+	solver_free(solver);
+}
+
+int main(int argc, char **argv)
+{
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+
+	bench_map(&standard_map);
+	bench_map(&difficult_map);
+	bench_map(&four_bridges_map);
+	return 0;
+}
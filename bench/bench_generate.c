@@ -0,0 +1,376 @@
+/*
+	Deal generation time of generate_board() compared to the original
+	recursive generator, which rescanned the whole grid on every level.
+	Every generated deal is checked to hold the full pile and to be
+	solvable. A second run with a tight node budget shows how restarts
+	bound the time spent on a deal, a third one how racing several
+	searches on threads cuts the median and tail latency. Finally the
+	deals are generated in short time slices to show how long the
+	interface would have to wait for the generator at worst, and taken
+	from a deal pool after writing it out and reading it back.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "pool.h"
+#include "storage.h"
+#include "solver.h"
+#include "bench.h"
+
+#define DEALS 200
+#define REFERENCE_DEALS 20
+#define SOLVER_NODES 20000
+#define TIGHT_NODE_LIMIT 72 /* The pairs of a deal, any backtracking starts over */
+#define RACE_DEALS 100
+#define STEP_SLICE 0.0005
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+static rng_t g_reference_rng;
+
+/* The original generator, taking a grid apart with a fresh scan and allocation per level */
+static int reference_colorize(grid_t grid, chip_t *pairs, int pile_size, grid_t result)
+{
+	int i, j;
+	positions_t *positions = malloc(sizeof(positions_t));
+
+	scan_selectable_positions(grid, positions);
+	if(positions->count < 2) {
+		free(positions);
+		return 0;
+	}
+
+	shuffle(&g_reference_rng, positions->positions, positions->count, sizeof(position_t));
+
+	if(pile_size == 2) {
+		const position_t *p1 = &positions->positions[0];
+		const position_t *p2 = &positions->positions[1];
+		result[p1->y][p1->x][p1->z] = pairs[0];
+		result[p2->y][p2->x][p2->z] = pairs[1];
+
+		free(positions);
+		return 1;
+	}
+
+	for(i = 0; i < positions->count - 1; ++i) {
+		for(j = i + 1; j < positions->count; ++j) {
+			const position_t *p1 = &positions->positions[i];
+			const position_t *p2 = &positions->positions[j];
+
+			grid[p1->y][p1->x][p1->z] = 0;
+			grid[p2->y][p2->x][p2->z] = 0;
+
+			if(reference_colorize(grid, &pairs[2], pile_size - 2, result)) {
+				result[p1->y][p1->x][p1->z] = pairs[0];
+				result[p2->y][p2->x][p2->z] = pairs[1];
+
+				free(positions);
+				return 1;
+			}
+
+			grid[p1->y][p1->x][p1->z] = CHIP_PLACEHOLDER;
+			grid[p2->y][p2->x][p2->z] = CHIP_PLACEHOLDER;
+		}
+	}
+
+	free(positions);
+	return 0;
+}
+
+static void reference_generate(const map_t *map, grid_t tmp, grid_t result)
+{
+	unsigned int i;
+	chip_t pile[MAX_CHIP_COUNT];
+
+	for(i = 0; i < map->chip_count; ++i)
+		pile[i] = (chip_t) (CHIP_CATEGORY_CHARACTER | (i % 9 + 1));
+	shuffle(&g_reference_rng, pile, map->chip_count / 2, 2 * sizeof(chip_t));
+
+	memset(tmp, 0, sizeof(grid_t));
+	memset(result, 0, sizeof(grid_t));
+	for(i = 0; i < map->chip_count; ++i)
+		tmp[map->chip[i].y][map->chip[i].x][map->chip[i].z] = CHIP_PLACEHOLDER;
+	for(i = 0; i < map->block_count; ++i)
+		tmp[map->block[i].y][map->block[i].x][map->block[i].z] = CHIP_CATEGORY_BLOCK | 1;
+
+	reference_colorize(tmp, pile, map->chip_count, result);
+}
+
+/* Each class holds four chips, blockers sit on their slots */
+static int full_pile(const board_t *board)
+{
+	int i;
+	int count[CHIP_CLASS_COUNT] = { 0 };
+	const layout_t *layout = board->layout;
+
+	for(i = 0; i < layout->slot_count; ++i) {
+		const chip_t chip = board_chip(board, i);
+		if(layout->blocker[i] != ((chip & CHIP_CATEGORY_MASK) == CHIP_CATEGORY_BLOCK))
+			return 0;
+		if(!layout->blocker[i]) {
+			if(chip_class(chip) == CHIP_CLASS_NONE)
+				return 0;
+			++count[chip_class(chip)];
+		}
+	}
+	for(i = 0; i < CHIP_CLASS_COUNT; ++i)
+		if(count[i] != 4)
+			return 0;
+	return 1;
+}
+
+static void check_deal(const map_t *map, const board_t *board, int ok, int i)
+{
+	if(!ok || !full_pile(board)) {
+		printf("%s: deal %d does not hold the full pile\n", map->name, i);
+		exit(1);
+	}
+}
+
+/* The deal ID has to bring back the same board */
+static void check_replay(map_t *map, const board_t *board, uint32_t seed, int i)
+{
+	char text[DEAL_ID_LENGTH + 1];
+	deal_id_t id = make_deal_id(map, seed, DIFFICULTY_NORMAL);
+	deal_id_t parsed;
+	board_t replay;
+
+	deal_id_format(&id, text);
+	if(!deal_id_parse(text, &parsed) || !generate_deal(&replay, map, &parsed)
+		|| memcmp(replay.chip, board->chip, board->layout->slot_count)) {
+		printf("%s: deal %d (%s) comes out differently the second time\n", map->name, i, text);
+		exit(1);
+	}
+}
+
+static int cmp_seconds(const void *p1, const void *p2)
+{
+	const double a = *(const double *) p1;
+	const double b = *(const double *) p2;
+	return (a > b) - (a < b);
+}
+
+/* Median and worst latency of thread_count racing searches with the tight budget */
+static void bench_race(map_t *map, int thread_count, double *median, double *worst, int *failed)
+{
+	int i;
+	double seconds[RACE_DEALS];
+	generator_limits_t tight = generator_default_limits;
+	generator_stats_t stats;
+	board_t board;
+
+	tight.node_limit = TIGHT_NODE_LIMIT;
+	tight.restart_limit = 1000;
+	*failed = 0;
+	for(i = 0; i < RACE_DEALS; ++i) {
+		if(generate_board_parallel(&board, map, rrand_u32(), DIFFICULTY_NORMAL, thread_count, &tight, &stats)) {
+			board_t again;
+
+			check_deal(map, &board, 1, i);
+			/* Whichever search won, its seed makes the same deal on its own */
+			if(!generate_board(&again, map, stats.seed, DIFFICULTY_NORMAL, &tight, NULL) || memcmp(again.chip, board.chip, board.layout->slot_count)) {
+				printf("%s: raced deal %d comes out differently alone\n", map->name, i);
+				exit(1);
+			}
+		}
+		else
+			++*failed;
+		seconds[i] = stats.seconds;
+	}
+	qsort(seconds, RACE_DEALS, sizeof(double), cmp_seconds);
+	*median = seconds[RACE_DEALS / 2];
+	*worst = seconds[RACE_DEALS - 1];
+}
+
+/* Generates deals in slices, returns the longest step */
+static double bench_steps(map_t *map, int *steps)
+{
+	int i;
+	double worst = 0;
+	board_t board;
+
+	*steps = 0;
+	for(i = 0; i < RACE_DEALS; ++i) {
+		int result;
+		generator_t *gen = generator_start(map, rrand_u32(), DIFFICULTY_NORMAL, NULL);
+
+		do {
+			const double t0 = bench_now();
+			double t;
+
+			result = generator_step(gen, STEP_SLICE);
+			t = bench_now() - t0;
+			if(t > worst)
+				worst = t;
+			++*steps;
+		} while(result == GENERATOR_RUNNING);
+
+		check_deal(map, &board, result && generator_deal(gen, &board, NULL), i);
+		generator_free(gen);
+	}
+	return worst;
+}
+
+/* Fills a pool, passes it through a file and takes the deals, returns the time per take */
+static double bench_pool(map_t *map)
+{
+	int i;
+	double t = 0;
+	uint32_t seed;
+	board_t board;
+	deal_pool_t *pool = deal_pool_create(rrand_u32());
+	deal_pool_t *copy = deal_pool_create(rrand_u32());
+	FILE *f = tmpfile();
+
+	deal_pool_add_map(pool, map);
+	deal_pool_add_map(copy, map);
+	while(deal_pool_fill(pool, 0))
+		;
+	deal_pool_write(pool, f);
+	rewind(f);
+	if(deal_pool_read(copy, f) != DEAL_POOL_SIZE) {
+		printf("%s: the pool was not read back\n", map->name);
+		exit(1);
+	}
+	fclose(f);
+
+	for(i = 0; i < DEAL_POOL_SIZE; ++i) {
+		const double t0 = bench_now();
+		if(!deal_pool_take(copy, map, &board, &seed)) {
+			printf("%s: the pool ran out early\n", map->name);
+			exit(1);
+		}
+		t += bench_now() - t0;
+		check_deal(map, &board, 1, i);
+		check_replay(map, &board, seed, i);
+	}
+
+	/* Now empty, the worker has to fill it up again */
+	deal_pool_start(copy);
+	while(!deal_pool_take(copy, map, &board, &seed))
+		;
+	check_deal(map, &board, 1, i);
+	check_replay(map, &board, seed, i);
+
+	deal_pool_destroy(pool);
+	deal_pool_destroy(copy);
+	return t / DEAL_POOL_SIZE;
+}
+
+static void bench_map(map_t *map, int thread_count)
+{
+	int i;
+	int solved = 0, unknown = 0;
+	int failed = 0;
+	long nodes = 0, max_nodes = 0;
+	int restarts = 0, max_restarts = 0;
+	double t0, t, worst = 0, t_reference;
+	generator_limits_t tight = generator_default_limits;
+	generator_stats_t stats;
+	board_t board;
+	grid_t *tmp = malloc(sizeof(grid_t));
+	grid_t *result = malloc(sizeof(grid_t));
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+
+	map_layout(map);
+
+	t0 = bench_now();
+	for(i = 0; i < REFERENCE_DEALS; ++i)
+		reference_generate(map, *tmp, *result);
+	t_reference = (bench_now() - t0) / REFERENCE_DEALS;
+
+	t = 0;
+	for(i = 0; i < DEALS; ++i) {
+		check_deal(map, &board, generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, &stats), i);
+		check_replay(map, &board, stats.seed, i);
+		t += stats.seconds;
+		if(stats.seconds > worst)
+			worst = stats.seconds;
+		nodes += stats.nodes;
+		if(stats.nodes > max_nodes)
+			max_nodes = stats.nodes;
+	}
+	t /= DEALS;
+
+	for(i = 0; i < DEALS; ++i) {
+		int result;
+
+		check_deal(map, &board, generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, NULL), i);
+		result = solve_board(solver, &board, &solver_limits, NULL, NULL);
+		if(result == 0) {
+			printf("%s: deal %d cannot be solved\n", map->name, i);
+			exit(1);
+		}
+		solved += result == 1;
+		unknown += result == -1;
+	}
+
+	printf("%-14s original %7.1f us  generator %6.1f us (worst %6.1f us)  speedup %5.1fx  solved %d, over budget %d\n",
+		map->name,
+		t_reference * 1e6, t * 1e6, worst * 1e6, t_reference / t,
+		solved, unknown);
+	printf("%-14s nodes %5.1f (max %ld)", map->name, nodes / (double) DEALS, max_nodes);
+
+	/* Same again with a budget that most attempts exceed */
+	tight.node_limit = TIGHT_NODE_LIMIT;
+	tight.restart_limit = 1000;
+	worst = 0;
+	for(i = 0; i < DEALS; ++i) {
+		if(generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, &tight, &stats))
+			check_deal(map, &board, 1, i);
+		else
+			++failed;
+		restarts += stats.restarts;
+		if(stats.restarts > max_restarts)
+			max_restarts = stats.restarts;
+		if(stats.seconds > worst)
+			worst = stats.seconds;
+	}
+	printf("  with %d nodes per attempt: restarts %5.1f (max %d), worst %6.1f us, failed %d\n",
+		TIGHT_NODE_LIMIT, restarts / (double) DEALS, max_restarts, worst * 1e6, failed);
+
+	{
+		double median1, worst1, median_n, worst_n;
+		int failed1, failed_n;
+
+		bench_race(map, 1, &median1, &worst1, &failed1);
+		bench_race(map, thread_count, &median_n, &worst_n, &failed_n);
+		printf("%-14s 1 thread median %6.1f us (worst %7.1f us)  %d threads median %6.1f us (worst %7.1f us)  failed %d/%d\n",
+			map->name, median1 * 1e6, worst1 * 1e6,
+			thread_count, median_n * 1e6, worst_n * 1e6, failed1, failed_n);
+	}
+
+	{
+		int steps;
+		const double worst_step = bench_steps(map, &steps);
+		printf("%-14s in %.1f ms slices: %4.2f steps per deal, longest step %6.1f us, from the pool %5.2f us\n",
+			map->name, STEP_SLICE * 1e3, steps / (double) RACE_DEALS, worst_step * 1e6,
+			bench_pool(map) * 1e6);
+	}
+
+	free(tmp);
+	free(result);
+	solver_free(solver);
+}
+
+int main(int argc, char **argv)
+{
+	int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	rng_seed(&g_reference_rng, rrand_u32());
+	if(thread_count < 2)
+		thread_count = 2;
+	if(thread_count > GENERATOR_MAX_THREADS)
+		thread_count = GENERATOR_MAX_THREADS;
+
+	bench_map(&standard_map, thread_count);
+	bench_map(&difficult_map, thread_count);
+	bench_map(&four_bridges_map, thread_count);
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+	Games on the built-in maps played by always taking a hint: the first
+	legal move as the old hints gave it, the top move of the ranking by
+	what the moves do to the board, and the top move after looking ahead
+	from every move. Reports the share of games won and the time ranking
+	and looking ahead take per position. Every ranked list has to hold
+	exactly the legal moves, and a move ranked first for leading to a win
+	must not lose.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "hint.h"
+#include "maps.h"
+#include "solver.h"
+#include "bench.h"
+
+#define GAMES 20 /* Per map */
+#define SOLVER_NODES 1000000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+enum { FIRST_FIT, RANKED, LOOKED_AHEAD, PLAYER_COUNT };
+
+static const char *player_name[PLAYER_COUNT] = { "first fit", "ranked", "looked ahead" };
+
+typedef struct {
+	int won;
+	long positions;
+	double seconds;
+	double worst;
+} player_stats_t;
+
+static void check_list(const map_t *map, const hint_list_t *list, const board_t *board)
+{
+	int i, j;
+	move_t moves[MAX_MOVE_COUNT];
+	const int count = board_moves(board, moves, MAX_MOVE_COUNT);
+
+	if(list->count != count) {
+		printf("%s: %d hints for %d moves\n", map->name, list->count, count);
+		exit(1);
+	}
+	for(i = 0; i < count; ++i) {
+		for(j = 0; j < count; ++j)
+			if(list->hint[j].move.slot1 == moves[i].slot1 && list->hint[j].move.slot2 == moves[i].slot2)
+				break;
+		if(j == count) {
+			printf("%s: a legal move is missing from the hints\n", map->name);
+			exit(1);
+		}
+	}
+}
+
+/* Plays the deal to the end, returns 1 if won */
+static int play(map_t *map, const board_t *deal, int player, player_stats_t *stats, hint_list_t *list, solver_t *solver)
+{
+	board_t board = *deal;
+	move_t moves[MAX_MOVE_COUNT];
+
+	while(board.tile_count > 0) {
+		move_t move;
+		double t0, t;
+
+		t0 = bench_now();
+		if(player == FIRST_FIT) {
+			if(board_moves(&board, moves, MAX_MOVE_COUNT) == 0)
+				return 0;
+			move = moves[0];
+		}
+		else {
+			list->ready = 0;
+			if(player == RANKED)
+				hint_rank(list, &board);
+			else
+				hint_look_ahead(list, &board, 0);
+			if(list->count == 0)
+				return 0;
+			move = list->hint[0].move;
+		}
+		t = bench_now() - t0;
+		stats->seconds += t;
+		if(t > stats->worst)
+			stats->worst = t;
+		++stats->positions;
+
+		if(player != FIRST_FIT)
+			check_list(map, list, &board);
+
+		board_remove_chip(&board, move.slot1);
+		board_remove_chip(&board, move.slot2);
+
+		/* A move known to lead to a win has to come first if there is one */
+		if(player == LOOKED_AHEAD && list->hint[0].score >= HINT_WINS && solve_board(solver, &board, &solver_limits, NULL, NULL) == 0) {
+			printf("%s: the top hint was said to lead to a win, but loses\n", map->name);
+			exit(1);
+		}
+	}
+	return 1;
+}
+
+static void bench_map(map_t *map, hint_list_t *list, solver_t *solver)
+{
+	int game, p;
+	player_stats_t stats[PLAYER_COUNT];
+	board_t deal;
+
+	memset(stats, 0, sizeof(stats));
+	for(game = 0; game < GAMES; ++game) {
+		generate_board(&deal, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, NULL);
+		for(p = 0; p < PLAYER_COUNT; ++p)
+			stats[p].won += play(map, &deal, p, &stats[p], list, solver);
+	}
+
+	for(p = 0; p < PLAYER_COUNT; ++p)
+		printf("%-14s %-12s won %3d of %3d (%5.1f%%)  mean %8.1f us, worst %8.1f us per position\n",
+			map->name, player_name[p], stats[p].won, GAMES, stats[p].won * 100.0 / GAMES,
+			stats[p].seconds * 1e6 / stats[p].positions, stats[p].worst * 1e6);
+}
+
+int main(int argc, char **argv)
+{
+	hint_list_t *list = (hint_list_t *) malloc(sizeof(hint_list_t));
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	bench_map(&standard_map, list, solver);
+	bench_map(&difficult_map, list, solver);
+	bench_map(&four_bridges_map, list, solver);
+	free(list);
+	solver_free(solver);
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+	The background winnability monitor on random games on the built-in
+	maps: how long asking takes, which is all the player ever waits for,
+	how long the answers take to come, and how many positions are answered
+	from the cache when the game is taken back move by move. The answers
+	are checked against the exact solver.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "maps.h"
+#include "monitor.h"
+#include "solver.h"
+#include "bench.h"
+
+#define GAMES 4 /* Per map */
+#define SOLVER_NODES 1000000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+static const char *answer_name[] = { "pending", "winnable", "lost", "unknown" };
+
+typedef struct {
+	long asks;
+	double ask_time;
+	double worst_ask;
+	int answers[4];
+	double wait_time;
+	double worst_wait;
+	int cache_hits;
+	int taken_back;
+} totals_t;
+
+static monitor_answer_t timed_ask(monitor_t *monitor, const board_t *board, totals_t *totals)
+{
+	const double t0 = bench_now();
+	const monitor_answer_t answer = monitor_ask(monitor, board);
+	const double t = bench_now() - t0;
+
+	++totals->asks;
+	totals->ask_time += t;
+	if(t > totals->worst_ask)
+		totals->worst_ask = t;
+	return answer;
+}
+
+static monitor_answer_t wait_for_answer(monitor_t *monitor, const board_t *board, totals_t *totals)
+{
+	monitor_answer_t answer;
+	const double t0 = bench_now();
+	double t;
+
+	while((answer = timed_ask(monitor, board, totals)) == MONITOR_PENDING)
+		usleep(1000);
+	t = bench_now() - t0;
+	totals->wait_time += t;
+	if(t > totals->worst_wait)
+		totals->worst_wait = t;
+	return answer;
+}
+
+static void check_answer(map_t *map, int game, int move, const board_t *board, monitor_answer_t answer, solver_t *solver)
+{
+	const int result = solve_board(solver, board, &solver_limits, NULL, NULL);
+
+	if((answer == MONITOR_WINNABLE && result == 0) || (answer == MONITOR_LOST && result == 1)) {
+		printf("%s: game %d, move %d was called %s, the solver says %d\n", map->name, game, move, answer_name[answer], result);
+		exit(1);
+	}
+}
+
+static void bench_map(map_t *map, monitor_t *monitor, solver_t *solver)
+{
+	int game, i;
+	int moves[MAX_CHIP_COUNT];
+	board_t *states = malloc(sizeof(board_t) * (MAX_CHIP_COUNT / 2 + 1));
+	totals_t totals;
+	int positions = 0;
+
+	memset(&totals, 0, sizeof(totals));
+	for(game = 0; game < GAMES; ++game) {
+		const int count = record_game(map, states, moves);
+		monitor_answer_t *answers = malloc(sizeof(monitor_answer_t) * count);
+
+		/* Players going faster than the monitor only get answers about where they stop */
+		for(i = 0; i < count; i += 4)
+			timed_ask(monitor, &states[i], &totals);
+
+		for(i = 0; i < count; ++i) {
+			answers[i] = wait_for_answer(monitor, &states[i], &totals);
+			++totals.answers[answers[i]];
+			check_answer(map, game, i, &states[i], answers[i], solver);
+		}
+		positions += count;
+
+		/* Taking back every move */
+		for(i = count - 1; i >= 0; --i) {
+			const monitor_answer_t answer = timed_ask(monitor, &states[i], &totals);
+
+			if(answer != MONITOR_PENDING && answer != answers[i]) {
+				printf("%s: game %d, move %d was called %s and then %s\n", map->name, game, i, answer_name[answers[i]], answer_name[answer]);
+				exit(1);
+			}
+			totals.cache_hits += answer != MONITOR_PENDING;
+			++totals.taken_back;
+		}
+		free(answers);
+	}
+
+	printf("%-14s %4d positions  ask mean %5.2f us, worst %6.1f us  answer mean %7.2f ms, worst %7.1f ms  winnable %3d, lost %3d, unknown %2d  taken back from the cache %3d of %3d\n",
+		map->name, positions, totals.ask_time * 1e6 / totals.asks, totals.worst_ask * 1e6,
+		totals.wait_time * 1e3 / positions, totals.worst_wait * 1e3,
+		totals.answers[MONITOR_WINNABLE], totals.answers[MONITOR_LOST], totals.answers[MONITOR_UNKNOWN],
+		totals.cache_hits, totals.taken_back);
+	free(states);
+}
+
+int main(int argc, char **argv)
+{
+	monitor_t *monitor = monitor_create();
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+
+	if(monitor == NULL) {
+		printf("The monitor could not be started\n");
+		return 1;
+	}
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	printf("Time limit %.1f s per position\n", MONITOR_TIME_LIMIT);
+	bench_map(&standard_map, monitor, solver);
+	bench_map(&difficult_map, monitor, solver);
+	bench_map(&four_bridges_map, monitor, solver);
+	monitor_destroy(monitor);
+	solver_free(solver);
+	return 0;
+}
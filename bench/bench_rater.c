@@ -0,0 +1,95 @@
+/*
+	Deals of each difficulty on the built-in maps rated by random and
+	greedy games, with the time a rating takes from 1 to N threads. Every
+	thread count has to come to the same rating, the rating has to lie in
+	its confidence interval and a second rating from other seeds has to
+	agree with it within the intervals of both.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "maps.h"
+#include "rater.h"
+#include "bench.h"
+
+#define DEALS 4 /* Per map and difficulty */
+#define GAMES RATER_DEFAULT_GAMES
+
+static const char *policy_name[RATER_POLICY_COUNT] = { "random", "greedy" };
+static const char *difficulty_name[DIFFICULTY_COUNT] = { "normal", "easy", "hard" };
+
+static void check_rating(const map_t *map, const rating_t *rating, const rating_t *first, uint32_t seed, int threads)
+{
+	if(rating->games != GAMES || rating->low > rating->win_rate || rating->high < rating->win_rate
+		|| rating->low < 0 || rating->high > 1) {
+		printf("%s: deal %u rated %d of %d won, in %.3f ... %.3f\n", map->name, seed, rating->won, rating->games, rating->low, rating->high);
+		exit(1);
+	}
+	if(first != NULL && (rating->won != first->won || rating->tiles_left != first->tiles_left)) {
+		printf("%s: deal %u rated %d won on 1 thread, %d on %d threads\n", map->name, seed, first->won, rating->won, threads);
+		exit(1);
+	}
+}
+
+static void bench_map(map_t *map, int max_threads)
+{
+	int policy, difficulty, i, threads;
+	board_t board;
+	rating_t first, rating, again;
+
+	for(policy = 0; policy < RATER_POLICY_COUNT; ++policy) {
+		for(difficulty = 0; difficulty < DIFFICULTY_COUNT; ++difficulty) {
+			double won = 0, seconds[RATER_MAX_THREADS + 1] = { 0 };
+			int disagree = 0;
+
+			for(i = 0; i < DEALS; ++i) {
+				const uint32_t seed = rrand_u32();
+
+				if(!generate_board(&board, map, seed, difficulty, NULL, NULL)) {
+					printf("%s: no %s deal found\n", map->name, difficulty_name[difficulty]);
+					exit(1);
+				}
+				for(threads = 1; threads <= max_threads; threads *= 2) {
+					rate_board(&board, policy, GAMES, threads, seed, &rating);
+					check_rating(map, &rating, threads == 1 ? NULL : &first, seed, threads);
+					if(threads == 1)
+						first = rating;
+					seconds[threads] += rating.seconds;
+				}
+				won += first.win_rate;
+
+				/* Two ratings far apart would be a bad sign, but one in twenty intervals misses by design */
+				rate_board(&board, policy, GAMES, max_threads, (uint64_t) seed << 32, &again);
+				disagree += again.high < first.low || again.low > first.high;
+			}
+			if(disagree == DEALS) {
+				printf("%s: no %s rating of %s deals came out the same twice\n", map->name, policy_name[policy], difficulty_name[difficulty]);
+				exit(1);
+			}
+
+			printf("%-14s %-6s %-6s won %5.1f%%", map->name, policy_name[policy], difficulty_name[difficulty], won * 100 / DEALS);
+			for(threads = 1; threads <= max_threads; threads *= 2)
+				printf("  %2d threads %6.1f ms", threads, seconds[threads] * 1e3 / DEALS);
+			printf("\n");
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int max_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	if(max_threads > RATER_MAX_THREADS)
+		max_threads = RATER_MAX_THREADS;
+	if(max_threads < 2)
+		max_threads = 2; /* Still checks that threads agree */
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	printf("%d games per rating\n", GAMES);
+	bench_map(&standard_map, max_threads);
+	bench_map(&difficult_map, max_threads);
+	bench_map(&four_bridges_map, max_threads);
+	return 0;
+}
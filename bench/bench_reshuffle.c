@@ -0,0 +1,151 @@
+/*
+	Latency of reshuffle_board() on boards from random games, where the
+	player got stuck and at states along the way, compared to dealing
+	a whole new board. Every reshuffle is checked to keep the removed chips
+	and the remaining pile, and to be solvable.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "solver.h"
+#include "bench.h"
+
+#define GAMES 100
+#define MANY_TILES 100
+#define SOLVER_NODES 20000
+#define STATE_STEP 5
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+static int cmp_seconds(const void *p1, const void *p2)
+{
+	const double a = *(const double *) p1;
+	const double b = *(const double *) p2;
+	return (a > b) - (a < b);
+}
+
+static void check_reshuffle(const map_t *map, const board_t *before, const board_t *after, int game)
+{
+	int i;
+	int count[256] = { 0 };
+	const layout_t *layout = before->layout;
+
+	if(memcmp(&before->state, &after->state, sizeof(board_state_t)) || before->tile_count != after->tile_count) {
+		printf("%s: reshuffle in game %d changed the occupied slots\n", map->name, game);
+		exit(1);
+	}
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(board_removed(before, i)) {
+			if(before->chip[i] != after->chip[i]) {
+				printf("%s: reshuffle in game %d touched a removed chip\n", map->name, game);
+				exit(1);
+			}
+			continue;
+		}
+		++count[before->chip[i]];
+		--count[after->chip[i]];
+	}
+	for(i = 0; i < 256; ++i) {
+		if(count[i]) {
+			printf("%s: reshuffle in game %d changed the pile\n", map->name, game);
+			exit(1);
+		}
+	}
+}
+
+/* Reshuffles the board, checks the result and returns the time it took or -1 if it failed */
+static double reshuffle(const map_t *map, const board_t *board, solver_t *solver, int game, int *unknown)
+{
+	board_t copy = *board;
+	generator_stats_t stats;
+	int result;
+
+	if(!reshuffle_board(&copy, rrand_u32(), NULL, &stats))
+		return -1;
+
+	check_reshuffle(map, board, &copy, game);
+	result = solve_board(solver, &copy, &solver_limits, NULL, NULL);
+	if(result == 0) {
+		printf("%s: reshuffle in game %d cannot be solved\n", map->name, game);
+		exit(1);
+	}
+	*unknown += result == -1;
+	return stats.seconds;
+}
+
+static void bench_map(map_t *map)
+{
+	int i, game;
+	int stuck_count = 0, state_count = 0;
+	int failed = 0, unknown = 0;
+	int tiles = 0;
+	double t0, t_generate;
+	double *stuck = malloc(sizeof(double) * GAMES);
+	double *states_seconds = malloc(sizeof(double) * GAMES * (MAX_CHIP_COUNT / 2 + 1));
+	board_t board;
+	board_t *states = malloc(sizeof(board_t) * (MAX_CHIP_COUNT / 2 + 1));
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+	int moves[MAX_CHIP_COUNT];
+
+	t0 = bench_now();
+	for(i = 0; i < GAMES; ++i)
+		generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, NULL);
+	t_generate = (bench_now() - t0) / GAMES;
+
+	for(game = 0; game < GAMES; ++game) {
+		const int count = record_game(map, states, moves);
+		const board_t *last = &states[count - 1];
+		double t;
+
+		/* Where the player got stuck, unless the game was won */
+		if(last->tile_count > 0) {
+			t = reshuffle(map, last, solver, game, &unknown);
+			if(t < 0)
+				++failed;
+			else if(last->tile_count >= MANY_TILES)
+				stuck[stuck_count++] = t;
+			tiles += last->tile_count;
+		}
+
+		/* Every few states along the way, checking them all would take long */
+		for(i = 0; i < count - 1; i += STATE_STEP) {
+			if(states[i].tile_count < MANY_TILES)
+				continue;
+			t = reshuffle(map, &states[i], solver, game, &unknown);
+			if(t < 0)
+				++failed;
+			else
+				states_seconds[state_count++] = t;
+		}
+	}
+
+	qsort(stuck, stuck_count, sizeof(double), cmp_seconds);
+	qsort(states_seconds, state_count, sizeof(double), cmp_seconds);
+	printf("%-14s new deal %6.1f us  stuck with %5.1f tiles left on average\n",
+		map->name, t_generate * 1e6, tiles / (double) GAMES);
+	if(stuck_count)
+		printf("%-14s stuck with %d+ tiles: %3d boards, reshuffle median %6.1f us, worst %6.1f us\n",
+			map->name, MANY_TILES, stuck_count, stuck[stuck_count / 2] * 1e6, stuck[stuck_count - 1] * 1e6);
+	printf("%-14s any state with %d+ tiles: %4d boards, reshuffle median %6.1f us, worst %6.1f us, failed %d, over budget %d\n",
+		map->name, MANY_TILES, state_count, states_seconds[state_count / 2] * 1e6, states_seconds[state_count - 1] * 1e6,
+		failed, unknown);
+
+	free(stuck);
+	free(states_seconds);
+	free(states);
+	solver_free(solver);
+}
+
+int main(int argc, char **argv)
+{
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+
+	bench_map(&standard_map);
+	bench_map(&difficult_map);
+	bench_map(&four_bridges_map);
+	return 0;
+}
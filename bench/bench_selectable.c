@@ -0,0 +1,232 @@
+/*
+	Compares get_selectable_positions() and the incrementally maintained
+	free set, class counts and move list against the original full grid scan on
+	states taken from random games on the built-in maps.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "bench.h"
+
+#define ROUNDS 200
+
+static int same_free_set(const board_t *board, positions_t *reference)
+{
+	int i;
+	positions_t positions;
+
+	for(i = 0; i < board->free.count; ++i)
+		positions.positions[i] = layout_position(board->layout, board->free.slot[i]);
+	positions.count = board->free.count;
+	for(i = 1; i < board->free.count; ++i)
+		if(board->free.slot[i - 1] >= board->free.slot[i])
+			return 0;
+	return same_positions(&positions, reference);
+}
+
+/* The class counts and the move list must agree with matching the free chips pairwise */
+static int same_moves(const board_t *board)
+{
+	int i, j;
+	int pairs = 0;
+	int tiles = 0;
+	move_t moves[MAX_MOVE_COUNT];
+	const int count = board_moves(board, moves, MAX_MOVE_COUNT);
+
+	for(i = 0; i < board->free.count - 1; ++i) {
+		for(j = i + 1; j < board->free.count; ++j) {
+			if(fits(board_chip(board, board->free.slot[i]), board_chip(board, board->free.slot[j]))) {
+				if(pairs >= count || moves[pairs].slot1 != board->free.slot[i] || moves[pairs].slot2 != board->free.slot[j])
+					return 0;
+				++pairs;
+			}
+		}
+	}
+	for(i = 0; i < board->layout->slot_count; ++i)
+		tiles += !board->layout->blocker[i] && !board_removed(board, i);
+	return pairs == count && pairs == board->free_pair_count && tiles == board->tile_count;
+}
+
+/* The free set must match the grid scan, and undoing the move must restore it exactly */
+static void check_free_sets(const map_t *map, board_t *states, grid_t *grids, const int *moves, int count)
+{
+	int i;
+	positions_t reference;
+
+	for(i = 0; i < count; ++i) {
+		board_t undone;
+
+		scan_selectable_positions(grids[i], &reference);
+		if(!same_free_set(&states[i], &reference)) {
+			printf("%s: free set after move %d differs from the grid scan\n", map->name, i);
+			exit(1);
+		}
+		if(!same_moves(&states[i])) {
+			printf("%s: moves after move %d differ from pairwise matching\n", map->name, i);
+			exit(1);
+		}
+
+		if(i + 1 == count)
+			break;
+		undone = states[i + 1];
+		board_restore_chip(&undone, moves[2 * i + 1], board_chip(&states[i], moves[2 * i + 1]));
+		board_restore_chip(&undone, moves[2 * i], board_chip(&states[i], moves[2 * i]));
+		if(undone.free.count != states[i].free.count
+			|| memcmp(undone.free.slot, states[i].free.slot, sizeof(int) * undone.free.count)
+			|| memcmp(undone.free_class_count, states[i].free_class_count, sizeof(undone.free_class_count))
+			|| undone.free_pair_count != states[i].free_pair_count
+			|| undone.tile_count != states[i].tile_count) {
+			printf("%s: undoing move %d does not restore the free set\n", map->name, i);
+			exit(1);
+		}
+	}
+}
+
+static int cmp_slot(const void *p1, const void *p2)
+{
+	return *(const int *) p1 - *(const int *) p2;
+}
+
+static void bench_map(map_t *map)
+{
+	int i, round;
+	int count;
+	double t0, t_scan, t_selectable, t_rebuild, t_incremental, t_pairwise, t_buckets;
+	volatile int sink = 0;
+	positions_t reference;
+	board_t board;
+	board_t *states = malloc(sizeof(board_t) * (MAX_CHIP_COUNT / 2 + 1));
+	grid_t *grids = malloc(sizeof(grid_t) * (MAX_CHIP_COUNT / 2 + 1));
+	int moves[MAX_CHIP_COUNT];
+
+	count = record_game(map, states, moves);
+	for(i = 0; i < count; ++i)
+		board_to_grid(&states[i], grids[i]);
+	check_free_sets(map, states, grids, moves, count);
+
+	for(i = 0; i < count; ++i) {
+		positions_t *positions = get_selectable_positions(&states[i]);
+		scan_selectable_positions(grids[i], &reference);
+		if(!same_positions(positions, &reference)) {
+			printf("%s: state %d differs from the grid scan\n", map->name, i);
+			exit(1);
+		}
+		free(positions);
+	}
+
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round)
+		for(i = 0; i < count; ++i)
+			scan_selectable_positions(grids[i], &reference);
+	t_scan = bench_now() - t0;
+
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round)
+		for(i = 0; i < count; ++i)
+			free(get_selectable_positions(&states[i]));
+	t_selectable = bench_now() - t0;
+
+	/* Replay the game, rebuilding and sorting the selectable set after every move like before */
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		board = states[0];
+		for(i = 0; i < count - 1; ++i) {
+			int slots[MAX_CHIP_COUNT];
+			int k;
+			positions_t *positions;
+			const position_t pos1 = layout_position(board.layout, moves[2 * i]);
+			const position_t pos2 = layout_position(board.layout, moves[2 * i + 1]);
+
+			board_set(&board, &pos1, 0);
+			board_set(&board, &pos2, 0);
+			positions = get_selectable_positions(&board);
+			for(k = 0; k < positions->count; ++k)
+				slots[k] = layout_find(board.layout, &positions->positions[k]);
+			qsort(slots, positions->count, sizeof(int), cmp_slot);
+			free(positions);
+		}
+	}
+	t_rebuild = bench_now() - t0;
+
+	/* Replay the game with the incremental free set, undoing every move once */
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		board = states[0];
+		for(i = 0; i < count - 1; ++i) {
+			const chip_t chip1 = board_chip(&board, moves[2 * i]);
+			const chip_t chip2 = board_chip(&board, moves[2 * i + 1]);
+			board_remove_chip(&board, moves[2 * i]);
+			board_remove_chip(&board, moves[2 * i + 1]);
+			board_restore_chip(&board, moves[2 * i + 1], chip2);
+			board_restore_chip(&board, moves[2 * i], chip1);
+			board_remove_chip(&board, moves[2 * i]);
+			board_remove_chip(&board, moves[2 * i + 1]);
+		}
+	}
+	t_incremental = (bench_now() - t0) / 3;
+
+	/* Listing the moves by matching all free chips pairwise like before, and from the class buckets */
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		for(i = 0; i < count; ++i) {
+			move_t moves[MAX_MOVE_COUNT];
+			int j, k;
+			int n = 0;
+
+			for(j = 0; j < states[i].free.count - 1; ++j) {
+				const chip_t chip1 = board_chip(&states[i], states[i].free.slot[j]);
+				for(k = j + 1; k < states[i].free.count; ++k) {
+					if(fits(chip1, board_chip(&states[i], states[i].free.slot[k]))) {
+						moves[n].slot1 = states[i].free.slot[j];
+						moves[n].slot2 = states[i].free.slot[k];
+						++n;
+					}
+				}
+			}
+			sink += n + moves[0].slot1;
+		}
+	}
+	t_pairwise = bench_now() - t0;
+
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		for(i = 0; i < count; ++i) {
+			move_t moves[MAX_MOVE_COUNT];
+			sink += board_moves(&states[i], moves, MAX_MOVE_COUNT) + moves[0].slot1;
+		}
+	}
+	t_buckets = bench_now() - t0;
+
+	printf("%-14s %3d states  grid scan %8.2f us  selectable %5.2f us  speedup %5.1fx\n",
+		map->name, count,
+		t_scan * 1e6 / (ROUNDS * count),
+		t_selectable * 1e6 / (ROUNDS * count),
+		t_scan / t_selectable);
+	printf("%-14s %3d moves   rebuild   %8.2f us  free set %5.2f us  speedup %5.1fx\n",
+		map->name, count - 1,
+		t_rebuild * 1e6 / (ROUNDS * (count - 1)),
+		t_incremental * 1e6 / (ROUNDS * (count - 1)),
+		t_rebuild / t_incremental);
+	printf("%-14s %3d states  pairwise  %8.2f us  buckets  %5.2f us  speedup %5.1fx\n",
+		map->name, count,
+		t_pairwise * 1e6 / (ROUNDS * count),
+		t_buckets * 1e6 / (ROUNDS * count),
+		t_pairwise / t_buckets);
+
+	free(states);
+	free(grids);
+}
+
+int main(int argc, char **argv)
+{
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+
+	bench_map(&standard_map);
+	bench_map(&difficult_map);
+	bench_map(&four_bridges_map);
+	return 0;
+}
@@ -0,0 +1,237 @@
+/*
+	Cost of dealing, playing and saving on layouts of 72, 144 and 288
+	tiles, per tile. The small and the double layouts are the pyramids of
+	maps/Pavilion.map and maps/Ziggurat.map. Every deal is checked to hold
+	the pile for its size and to be solvable, and saved games to come back
+	the same, from the grid format of older versions as well.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "session.h"
+#include "storage.h"
+#include "solver.h"
+#include "bench.h"
+
+#define DEALS 50
+#define ROUNDS 20
+#define SOLVER_NODES 100000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+typedef struct {
+	int x, y; /* Of the first tile */
+	int width, height; /* In tiles */
+} layer_t;
+
+static const layer_t pavilion[] = {
+	{ 1, 1, 8, 5 },
+	{ 3, 2, 6, 4 },
+	{ 5, 4, 4, 2 }
+};
+
+static const layer_t ziggurat[] = {
+	{ 1, 1, 16, 8 },
+	{ 3, 3, 14, 6 },
+	{ 5, 5, 12, 4 },
+	{ 7, 7, 10, 2 },
+	{ 13, 7, 4, 2 }
+};
+
+static void build_pyramid(map_t *map, const char *name, int col_count, int row_count, const layer_t *layers, int layer_count)
+{
+	int z, i, j;
+
+	memset(map, 0, sizeof(map_t));
+	map->name = (char *) name;
+	map->col_count = col_count;
+	map->row_count = row_count;
+	map->chip = (position_t *) malloc(sizeof(position_t) * MAX_CHIP_COUNT);
+	for(z = 0; z < layer_count; ++z) {
+		for(j = 0; j < layers[z].height; ++j) {
+			for(i = 0; i < layers[z].width; ++i) {
+				position_t *pos = &map->chip[map->chip_count++];
+				pos->x = layers[z].x + 2 * i;
+				pos->y = layers[z].y + 2 * j;
+				pos->z = z;
+			}
+		}
+	}
+}
+
+static void check_pile(const map_t *map, const board_t *board, int i)
+{
+	int k;
+	int count[256] = { 0 };
+
+	for(k = 0; k < board->layout->slot_count; ++k)
+		++count[board_chip(board, k)];
+	for(k = 1; k < 256; ++k) {
+		if(count[k] != pile_count((chip_t) k, map->chip_count)) {
+			printf("%s: deal %d does not hold the pile of %u chips\n", map->name, i, map->chip_count);
+			exit(1);
+		}
+	}
+}
+
+static int same_game(const game_session_t *a, const game_session_t *b)
+{
+	const layout_t *layout = a->board.layout;
+
+	return layout->slot_count == b->board.layout->slot_count
+		&& !memcmp(a->board.chip, b->board.chip, layout->slot_count)
+		&& !memcmp(&a->board.state, &b->board.state, sizeof(board_state_t))
+		&& a->undo_count == b->undo_count
+		&& !memcmp(a->undo, b->undo, sizeof(move_t) * a->undo_count);
+}
+
+/* The format of older versions, which wrote every cell of the grid */
+static void write_grid(const game_session_t *session, FILE *f)
+{
+	int i, j, k;
+	const board_t *board = &session->board;
+
+	fprintf(f, "%d %d\n", session->row_count, session->col_count);
+	for(i = 0; i < MAX_ROW_COUNT; ++i) {
+		for(j = 0; j < MAX_COL_COUNT; ++j) {
+			for(k = 0; k < MAX_HEIGHT; ++k) {
+				position_t pos;
+				pos.y = i;
+				pos.x = j;
+				pos.z = k;
+				fprintf(f, "%d\n", board_get(board, &pos));
+			}
+		}
+	}
+	fprintf(f, "%d\n", 2 * session->undo_count);
+	for(i = 0; i < 2 * session->undo_count; ++i) {
+		const int slot = i % 2 ? session->undo[i / 2].slot2 : session->undo[i / 2].slot1;
+		const position_t pos = layout_position(board->layout, slot);
+		fprintf(f, "%d %d %d %d\n", pos.y, pos.x, pos.z, board->chip[slot]);
+	}
+}
+
+/* Saves and restores the game, returns the time of a round trip */
+static double save_and_load(const map_t *map, const game_session_t *session, game_session_t *restored, int grid)
+{
+	int round;
+	double t0 = bench_now();
+
+	for(round = 0; round < ROUNDS; ++round) {
+		FILE *f = tmpfile();
+
+		if(grid)
+			write_grid(session, f);
+		else
+			session_write(session, f);
+		rewind(f);
+		if(!session_read(restored, f) || !same_game(session, restored)) {
+			printf("%s: the saved game comes back differently%s\n", map->name, grid ? " from the grid format" : "");
+			exit(1);
+		}
+		fclose(f);
+	}
+	return (bench_now() - t0) / ROUNDS;
+}
+
+static void bench_map(map_t *map)
+{
+	int i, k, round;
+	int count;
+	int unknown = 0;
+	volatile int sink = 0;
+	double t_generate = 0, t0, t_moves, t_play, t_save, t_grid;
+	generator_stats_t stats;
+	board_t board;
+	board_t *states = malloc(sizeof(board_t) * (MAX_CHIP_COUNT / 2 + 1));
+	int moves[MAX_CHIP_COUNT];
+	solver_t *solver = solver_create(SOLVER_DEFAULT_TABLE_BITS);
+	game_session_t *session = session_create();
+	game_session_t *restored = session_create();
+	const int tiles = map->chip_count;
+
+	if(map_layout(map) == NULL) {
+		printf("%s: invalid map\n", map->name);
+		exit(1);
+	}
+
+	for(i = 0; i < DEALS; ++i) {
+		int result;
+
+		if(!generate_board(&board, map, rrand_u32(), DIFFICULTY_NORMAL, NULL, &stats)) {
+			printf("%s: no deal found\n", map->name);
+			exit(1);
+		}
+		t_generate += stats.seconds;
+		check_pile(map, &board, i);
+		result = solve_board(solver, &board, &solver_limits, NULL, NULL);
+		if(result == 0) {
+			printf("%s: deal %d cannot be solved\n", map->name, i);
+			exit(1);
+		}
+		unknown += result == -1;
+	}
+	t_generate /= DEALS;
+
+	count = record_game(map, states, moves);
+
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		for(i = 0; i < count; ++i) {
+			move_t legal[MAX_MOVE_COUNT];
+			sink += board_moves(&states[i], legal, MAX_MOVE_COUNT);
+		}
+	}
+	t_moves = (bench_now() - t0) / (ROUNDS * count);
+
+	t0 = bench_now();
+	for(round = 0; round < ROUNDS; ++round) {
+		board = states[0];
+		for(i = 0; i < count - 1; ++i) {
+			board_remove_chip(&board, moves[2 * i]);
+			board_remove_chip(&board, moves[2 * i + 1]);
+		}
+		sink += board.free.count;
+	}
+	t_play = count > 1 ? (bench_now() - t0) / (ROUNDS * (count - 1)) : 0;
+
+	/* Save halfway through the game */
+	session_use_deal(session, map, &states[0], 0);
+	for(k = 0; k < (count - 1) / 2; ++k)
+		session_apply_move(session, moves[2 * k], moves[2 * k + 1]);
+	t_save = save_and_load(map, session, restored, 0);
+	t_grid = save_and_load(map, session, restored, 1);
+
+	printf("%-14s %3d tiles  deal %7.1f us (%5.2f per tile)  moves %5.2f us  move %5.3f us  save and load %6.1f us (%5.2f per tile, grid %7.1f us)  over budget %d\n",
+		map->name, tiles,
+		t_generate * 1e6, t_generate * 1e6 / tiles,
+		t_moves * 1e6, t_play * 1e6,
+		t_save * 1e6, t_save * 1e6 / tiles, t_grid * 1e6,
+		unknown);
+
+	session_destroy(session);
+	session_destroy(restored);
+	free(states);
+	solver_free(solver);
+}
+
+int main(int argc, char **argv)
+{
+	map_t small, large;
+
+	rrand_seed(argc > 1 ? atoi(argv[1]) : time(NULL));
+	build_pyramid(&small, "Pavilion", 18, 12, pavilion, sizeof(pavilion) / sizeof(pavilion[0]));
+	build_pyramid(&large, "Ziggurat", 34, 18, ziggurat, sizeof(ziggurat) / sizeof(ziggurat[0]));
+
+	bench_map(&small);
+	bench_map(&standard_map);
+	bench_map(&large);
+
+	map_free(&small);
+	map_free(&large);
+	return 0;
+}
@@ -0,0 +1,130 @@
+/*
+	Scaling of the parallel solver from 1 to N threads on a fixed corpus
+	of positions on the Difficult map that take from tens of thousands to
+	millions of nodes, lost ones for the most part, N being the number of
+	processors unless given. Every thread count has to come to the same
+	answers as the single thread, and every winning line has to clear the
+	board. Each position is on a deal of its own, so no thread count finds
+	the table filled by the one before.
+
+	bench-solver-threads [max threads]
+*/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "maps.h"
+#include "solver.h"
+#include "bench.h"
+
+#define TABLE_BITS 18
+#define SOLVER_NODES 20000000
+
+static const solver_limits_t solver_limits = { SOLVER_NODES, 0, NULL };
+
+/* The deal of seed 1000 + deal after moves played at random from seed deal */
+typedef struct {
+	int deal;
+	int moves;
+} game_t;
+
+static const game_t games[] = {
+	{ 39, 4 }, { 14, 4 }, { 27, 6 }, { 12, 4 }, { 48, 4 }, { 21, 4 },
+	{ 26, 0 }, { 9, 0 }, { 3, 0 }
+};
+
+#define CORPUS ((int) (sizeof(games) / sizeof(games[0])))
+
+static void make_position(map_t *map, const game_t *game, board_t *board)
+{
+	int k;
+	rng_t rng;
+	move_t moves[MAX_MOVE_COUNT];
+
+	if(!generate_board(board, map, 1000 + game->deal, DIFFICULTY_NORMAL, NULL, NULL)) {
+		printf("%s: no deal found for seed %d\n", map->name, 1000 + game->deal);
+		exit(1);
+	}
+	rng_seed(&rng, game->deal);
+	for(k = 0; k < game->moves; ++k) {
+		const int count = board_moves(board, moves, MAX_MOVE_COUNT);
+		const move_t *move;
+
+		if(count == 0)
+			break;
+		move = &moves[rng_range(&rng, count)];
+		board_remove_chip(board, move->slot1);
+		board_remove_chip(board, move->slot2);
+	}
+}
+
+static void check_line(const board_t *position, const move_t *line, int i)
+{
+	int k, j;
+	board_t board = *position;
+
+	for(k = 0; k < position->tile_count / 2; ++k) {
+		move_t moves[MAX_MOVE_COUNT];
+		const int count = board_moves(&board, moves, MAX_MOVE_COUNT);
+
+		for(j = 0; j < count; ++j)
+			if(moves[j].slot1 == line[k].slot1 && moves[j].slot2 == line[k].slot2)
+				break;
+		if(j == count) {
+			printf("position %d: move %d of the winning line is not legal\n", i, k + 1);
+			exit(1);
+		}
+		board_remove_chip(&board, line[k].slot1);
+		board_remove_chip(&board, line[k].slot2);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i, threads;
+	int result[CORPUS];
+	board_t *corpus = malloc(sizeof(board_t) * CORPUS);
+	solver_t *solver = solver_create(TABLE_BITS);
+	const int max_threads = argc > 1 ? atoi(argv[1]) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+	double t1 = 0;
+
+	for(i = 0; i < CORPUS; ++i)
+		make_position(&difficult_map, &games[i], &corpus[i]);
+
+	for(threads = 1; threads <= max_threads && threads <= SOLVER_MAX_THREADS; ++threads) {
+		int won = 0, lost = 0, unknown = 0;
+		long nodes = 0, tasks = 0;
+		double t = 0;
+
+		for(i = 0; i < CORPUS; ++i) {
+			move_t line[MAX_CHIP_COUNT / 2];
+			solver_stats_t stats;
+			const int r = solve_board_parallel(solver, &corpus[i], threads, &solver_limits, line, &stats);
+
+			if(threads == 1)
+				result[i] = r;
+			else if(r != SOLVER_UNKNOWN && result[i] != SOLVER_UNKNOWN && r != result[i]) {
+				printf("position %d: %d threads say %d, one thread said %d\n", i, threads, r, result[i]);
+				exit(1);
+			}
+			if(r == 1)
+				check_line(&corpus[i], line, i);
+			won += r == 1;
+			lost += r == 0;
+			unknown += r == SOLVER_UNKNOWN;
+			nodes += stats.nodes;
+			tasks += stats.tasks;
+			t += stats.seconds;
+		}
+		if(threads == 1)
+			t1 = t;
+
+		printf("%2d threads  %7.2f s  %6.2f M nodes/s  speedup %5.2fx  handed off %6ld  won %d, lost %d, unknown %d\n",
+			threads, t, nodes / t * 1e-6, t1 / t, tasks, won, lost, unknown);
+	}
+
+	solver_free(solver);
+	free(corpus);
+	return 0;
+}
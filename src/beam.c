@@ -0,0 +1,315 @@
+#include <string.h>
+#include <time.h>
+#include "beam.h"
+#include "common.h"
+#include "layout.h"
+
+const beam_limits_t beam_default_limits = {
+	1 << 20, /* memory */
+	0.25, /* time_limit */
+	NULL /* cancel */
+};
+
+#define FIRST_WIDTH 4
+#define WIDTH_STEP 4 /* Growth per round */
+
+typedef struct {
+	board_t board;
+	unsigned char class_left[CHIP_CLASS_COUNT]; /* Chips of each class still on the board */
+	int stack; /* Levels of the chips left, added up */
+} beam_node_t;
+
+/* A move from a position of the beam, only the chosen ones are made */
+typedef struct {
+	int parent;
+	move_t move;
+	int score;
+} candidate_t;
+
+/* How a position of the beam was reached, to follow the line back */
+typedef struct {
+	int parent;
+	move_t move;
+} step_t;
+
+typedef struct {
+	int width;
+	int max_width;
+	int level_count;
+	int max_moves; /* Per position */
+	beam_node_t *layer[2];
+	candidate_t *candidates;
+	move_t *moves; /* Of the position being expanded */
+	step_t *steps; /* level_count + 1 levels of max_width */
+	int *seen; /* Open addressing set of the next level, 2 * max_width slots */
+	long nodes;
+	double deadline;
+	const int *cancel;
+} beam_t;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Out of time or cancelled */
+static int stopped(const beam_t *beam)
+{
+	return (beam->deadline && now() > beam->deadline)
+		|| (beam->cancel != NULL && __atomic_load_n(beam->cancel, __ATOMIC_RELAXED));
+}
+
+static size_t beam_bytes(int width, int level_count, int max_moves)
+{
+	return 2 * width * sizeof(beam_node_t)
+		+ (size_t) width * max_moves * sizeof(candidate_t)
+		+ (size_t) max_moves * sizeof(move_t)
+		+ (size_t) (level_count + 1) * width * sizeof(step_t)
+		+ 2 * width * sizeof(int);
+}
+
+/* Higher is better. Blocked chips weigh more when a class has many of them */
+static int score(const beam_node_t *node)
+{
+	int c;
+	int blocked = 0;
+	const board_t *board = &node->board;
+
+	for(c = 0; c < CHIP_CLASS_COUNT; ++c) {
+		const int b = node->class_left[c] - board->free_class_count[c];
+		blocked += b * b;
+	}
+	return 64 * board->free_pair_count - 12 * blocked - 6 * node->stack;
+}
+
+static void take(beam_node_t *node, const move_t *move)
+{
+	board_t *board = &node->board;
+
+	node->class_left[board->chip_class[move->slot1]] -= 2;
+	node->stack -= board->layout->z[move->slot1] + board->layout->z[move->slot2];
+	board_remove_chip(board, move->slot1);
+	board_remove_chip(board, move->slot2);
+}
+
+static void put_back(beam_node_t *node, const move_t *move)
+{
+	board_t *board = &node->board;
+
+	board_restore_chip(board, move->slot2, board->chip[move->slot2]);
+	board_restore_chip(board, move->slot1, board->chip[move->slot1]);
+	node->class_left[board->chip_class[move->slot1]] += 2;
+	node->stack += board->layout->z[move->slot1] + board->layout->z[move->slot2];
+}
+
+static int cmp_candidate(const void *p1, const void *p2)
+{
+	const candidate_t *a = (const candidate_t *) p1;
+	const candidate_t *b = (const candidate_t *) p2;
+
+	if(a->score != b->score)
+		return b->score - a->score;
+	if(a->parent != b->parent)
+		return a->parent - b->parent;
+	return a->move.slot1 != b->move.slot1 ? a->move.slot1 - b->move.slot1 : a->move.slot2 - b->move.slot2;
+}
+
+/* Adds the position to the next level unless it is there already */
+static int add_unique(beam_t *beam, beam_node_t *next, int count, const beam_node_t *node)
+{
+	const int size = 2 * beam->max_width;
+	int i = board_state_hash(&node->board.state) % size;
+
+	while(beam->seen[i] >= 0) {
+		if(!memcmp(&next[beam->seen[i]].board.state, &node->board.state, sizeof(board_state_t)))
+			return 0;
+		i = (i + 1) % size;
+	}
+	beam->seen[i] = count;
+	return 1;
+}
+
+static void follow_line(const beam_t *beam, int level, int parent, const move_t *last, move_t *line)
+{
+	line[level] = *last;
+	while(level > 0) {
+		const step_t *step = &beam->steps[level * beam->max_width + parent];
+		line[--level] = step->move;
+		parent = step->parent;
+	}
+}
+
+/* One round at the current width, returns 1, 0 or SOLVER_UNKNOWN like solve_board_beam() */
+static int run_round(beam_t *beam, const beam_node_t *root, move_t *line)
+{
+	int level, i, k;
+	int count = 1;
+	int left_out = 0;
+	beam_node_t *layer = beam->layer[0];
+	beam_node_t *next = beam->layer[1];
+	move_t *moves = beam->moves;
+
+	layer[0] = *root;
+
+	for(level = 0; level < beam->level_count; ++level) {
+		int candidate_count = 0;
+		int next_count = 0;
+
+		if(stopped(beam))
+			return SOLVER_UNKNOWN;
+
+		for(i = 0; i < count; ++i) {
+			beam_node_t *node = &layer[i];
+			int move_count = board_moves(&node->board, moves, beam->max_moves);
+
+			/* When all remaining chips of a class are free, taking two of them can't hurt */
+			for(k = 0; k < move_count; ++k) {
+				const int c = node->board.chip_class[moves[k].slot1];
+				if(node->class_left[c] == node->board.free_class_count[c]) {
+					moves[0] = moves[k];
+					move_count = 1;
+					break;
+				}
+			}
+
+			for(k = 0; k < move_count; ++k) {
+				candidate_t *candidate = &beam->candidates[candidate_count];
+
+				++beam->nodes;
+				take(node, &moves[k]);
+				if(node->board.tile_count == 0) {
+					if(line != NULL)
+						follow_line(beam, level, i, &moves[k], line);
+					return 1;
+				}
+				if(node->board.free_pair_count > 0) {
+					candidate->parent = i;
+					candidate->move = moves[k];
+					candidate->score = score(node);
+					++candidate_count;
+				}
+				put_back(node, &moves[k]);
+			}
+		}
+
+		if(candidate_count == 0)
+			break;
+		qsort(beam->candidates, candidate_count, sizeof(candidate_t), cmp_candidate);
+
+		for(k = 0; k < 2 * beam->max_width; ++k)
+			beam->seen[k] = -1;
+		for(k = 0; k < candidate_count; ++k) {
+			const candidate_t *candidate = &beam->candidates[k];
+			beam_node_t *node = &next[next_count];
+
+			if(next_count == beam->width) {
+				left_out = 1;
+				break;
+			}
+			*node = layer[candidate->parent];
+			take(node, &candidate->move);
+			/* Checked on the chosen ones only, lost positions don't take up room in the beam */
+			if(board_deadlocked_by(&node->board, &candidate->move))
+				continue;
+			if(add_unique(beam, next, next_count, node)) {
+				step_t *step = &beam->steps[(level + 1) * beam->max_width + next_count];
+				step->parent = candidate->parent;
+				step->move = candidate->move;
+				++next_count;
+			}
+		}
+
+		beam->layer[0] = next;
+		beam->layer[1] = layer;
+		layer = next;
+		next = beam->layer[1];
+		count = next_count;
+	}
+
+	return left_out ? SOLVER_UNKNOWN : 0;
+}
+
+int solve_board_beam(const board_t *board, const beam_limits_t *limits, move_t *line, beam_stats_t *stats)
+{
+	int i, class_size;
+	int chip_count = 0;
+	int result = SOLVER_UNKNOWN;
+	beam_t beam;
+	beam_node_t *root;
+	beam_stats_t own;
+	const double start = now();
+
+	if(limits == NULL)
+		limits = &beam_default_limits;
+	if(stats == NULL)
+		stats = &own;
+	memset(stats, 0, sizeof(beam_stats_t));
+	memset(&beam, 0, sizeof(beam_t));
+
+	/* Every class may have all its chips free, which gives the most moves */
+	for(i = 0; i < board->layout->slot_count; ++i)
+		chip_count += !board->layout->blocker[i];
+	class_size = (chip_count + CHIP_CLASS_COUNT - 1) / CHIP_CLASS_COUNT;
+	beam.level_count = board->tile_count / 2;
+	beam.max_moves = max_int(1, CHIP_CLASS_COUNT * class_size * (class_size - 1) / 2);
+	beam.max_width = 0;
+	while(beam_bytes(beam.max_width + 1, beam.level_count, beam.max_moves) + sizeof(beam_node_t) <= limits->memory)
+		++beam.max_width;
+	beam.deadline = limits->time_limit ? start + limits->time_limit : 0;
+	beam.cancel = limits->cancel;
+
+	root = (beam_node_t *) malloc(sizeof(beam_node_t));
+	if(beam.max_width == 0 || root == NULL) {
+		free(root);
+		return SOLVER_UNKNOWN;
+	}
+	root->board = *board;
+	root->stack = 0;
+	memset(root->class_left, 0, sizeof(root->class_left));
+	for(i = 0; i < board->layout->slot_count; ++i) {
+		if(!board_removed(board, i) && !board->layout->blocker[i]) {
+			++root->class_left[board->chip_class[i]];
+			root->stack += board->layout->z[i];
+		}
+	}
+
+	beam.layer[0] = (beam_node_t *) malloc(sizeof(beam_node_t) * beam.max_width);
+	beam.layer[1] = (beam_node_t *) malloc(sizeof(beam_node_t) * beam.max_width);
+	beam.candidates = (candidate_t *) malloc(sizeof(candidate_t) * beam.max_width * beam.max_moves);
+	beam.steps = (step_t *) malloc(sizeof(step_t) * (beam.level_count + 1) * beam.max_width);
+	beam.moves = (move_t *) malloc(sizeof(move_t) * beam.max_moves);
+	beam.seen = (int *) malloc(sizeof(int) * 2 * beam.max_width);
+
+	if(board->tile_count == 0) {
+		result = 1;
+	}
+	else if(board_deadlocked(board)) {
+		result = 0;
+	}
+	else if(beam.layer[0] && beam.layer[1] && beam.candidates && beam.moves && beam.steps && beam.seen) {
+		beam.width = min_int(FIRST_WIDTH, beam.max_width);
+		for(;;) {
+			++stats->rounds;
+			result = run_round(&beam, root, line);
+			if(result != SOLVER_UNKNOWN || beam.width == beam.max_width)
+				break;
+			if(stopped(&beam))
+				break;
+			beam.width = min_int(beam.width * WIDTH_STEP, beam.max_width);
+		}
+	}
+
+	stats->nodes = beam.nodes;
+	stats->width = beam.width;
+	stats->seconds = now() - start;
+	free(beam.layer[0]);
+	free(beam.layer[1]);
+	free(beam.candidates);
+	free(beam.moves);
+	free(beam.steps);
+	free(beam.seen);
+	free(root);
+	return result;
+}
@@ -0,0 +1,38 @@
+#ifndef BEAM_H
+#define BEAM_H
+
+#include "board.h"
+#include "solver.h"
+
+/*
+	Beam search for a winning line, for when an answer is needed quickly
+	and "don't know" is acceptable. Each level keeps the positions with the
+	best score among all moves from the level before, scored by the free
+	pairs, the chips of each class that are blocked and how high the chips
+	left are stacked. Rounds start narrow and get wider up to what the
+	memory allows, until a line is found or the time is up.
+*/
+typedef struct {
+	size_t memory; /* Bytes for the search, which set the widest beam */
+	double time_limit; /* Seconds, 0 for no limit */
+	const int *cancel; /* Set by another thread to stop the search, may be NULL */
+} beam_limits_t;
+
+extern const beam_limits_t beam_default_limits;
+
+typedef struct {
+	long nodes; /* Moves scored */
+	int rounds;
+	int width; /* Of the last round */
+	double seconds;
+} beam_stats_t;
+
+/*
+	Returns 1 with a winning line of tile_count / 2 moves in line (which may
+	be NULL), 0 if the board is lost, which is only known when no round
+	had to leave out a position, and SOLVER_UNKNOWN otherwise. limits may be
+	NULL for the defaults and stats may be NULL.
+*/
+int solve_board_beam(const board_t *board, const beam_limits_t *limits, move_t *line, beam_stats_t *stats);
+
+#endif
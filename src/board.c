@@ -1,7 +1,11 @@
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "board.h"
 #include "common.h"
+#include "layout.h"
 
 int position_equal(const position_t *pos1, const position_t *pos2)
 {
@@ -12,241 +16,1118 @@ int position_equal(const position_t *pos1, const position_t *pos2)
 
 chip_t board_get(const board_t *board, const position_t *pos)
 {
-	if(pos->y < 0 || pos->y >= MAX_ROW_COUNT)
-		return 0;
-	if(pos->x < 0 || pos->x >= MAX_COL_COUNT)
-		return 0;
-	if(pos->z < 0 || pos->z >= MAX_HEIGHT)
+	const int slot = layout_find(board->layout, pos);
+
+	if(slot < 0)
 		return 0;
 
-	return board->columns[pos->y][pos->x].chips[pos->z];
+	return board_chip(board, slot);
+}
+
+static void place_chip(board_t *board, int slot, chip_t chip)
+{
+	board->chip[slot] = chip;
+	board->chip_class[slot] = chip_class(chip);
+	board->state.removed[slot / 32] &= ~(1u << (slot % 32));
 }
 
 void board_set(board_t *board, const position_t *pos, chip_t chip)
 {
-	if(pos->y < 0 || pos->y >= MAX_ROW_COUNT)
-		return;
-	if(pos->x < 0 || pos->x >= MAX_COL_COUNT)
-		return;
-	if(pos->z < 0 || pos->z >= MAX_HEIGHT)
+	const int slot = layout_find(board->layout, pos);
+
+	if(slot < 0)
 		return;
 
-	board->columns[pos->y][pos->x].chips[pos->z] = chip;
+	if(chip)
+		place_chip(board, slot, chip);
+	else
+		board->state.removed[slot / 32] |= 1u << (slot % 32);
 }
 
-static int column_height(board_t *board, int y, int x)
+void board_init(board_t *board, const layout_t *layout)
 {
-	int k;
+	int i;
 
-	if(y < 0 || y >= MAX_ROW_COUNT)
-		return 0;
-	if(x < 0 || x >= MAX_COL_COUNT)
-		return 0;
+	memset(board, 0, sizeof(board_t));
+	board->layout = layout;
+	if(layout != NULL)
+		for(i = 0; i < layout->slot_count; ++i)
+			board->state.removed[i / 32] |= 1u << (i % 32);
+}
 
-	for(k = MAX_HEIGHT-1; k >= 0; --k)
-	{
-		chip_t chip = board->columns[y][x].chips[k];
-		if(chip)
-			return k + 1;
+/* FNV-1a */
+unsigned int board_state_hash(const board_state_t *state)
+{
+	size_t i;
+	unsigned int hash = 2166136261u;
+	const unsigned char *bytes = (const unsigned char *) state->removed;
+
+	for(i = 0; i < sizeof(state->removed); ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
 	}
-	return 0;
+	return hash;
 }
 
-static chip_t safe_get(const board_t *board, int y, int x, int k)
+positions_t* get_selectable_positions(board_t *board)
 {
-	if(y < 0 || y >= MAX_ROW_COUNT)
-		return 0;
-	if(x < 0 || x >= MAX_COL_COUNT)
-		return 0;
-	if(k < 0 || k >= MAX_HEIGHT)
-		return 0;
+	int i;
+	const layout_t *layout = board->layout;
+
+	positions_t* positions = malloc(sizeof(positions_t));
+	positions->count = 0;
 
-	return board->columns[y][x].chips[k];
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(layout_selectable(layout, board, i)) {
+			positions->positions[positions->count] = layout_position(layout, i);
+			++positions->count;
+		}
+	}
+
+	return positions;
 }
 
-static int selectable(board_t *board, int y, int x)
+unsigned char chip_class(chip_t chip)
 {
-	int i, j;
-	int h = column_height(board, y, x);
-	int l, r;
+	const int rank = chip & ~CHIP_CATEGORY_MASK;
 
-	/* No chip or a blocker? */
-	if(h == 0 || (safe_get(board, y, x, h - 1) & CHIP_CATEGORY_MASK) == CHIP_CATEGORY_BLOCK)
-		return 0;
+	switch(chip & CHIP_CATEGORY_MASK) {
+		case CHIP_CATEGORY_CHARACTER:
+			return rank - 1;
+		case CHIP_CATEGORY_DOTS:
+			return 9 + rank - 1;
+		case CHIP_CATEGORY_BAMBOO:
+			return 18 + rank - 1;
+		case CHIP_CATEGORY_WINDS:
+			return 27 + rank - 1;
+		case CHIP_CATEGORY_DRAGONS:
+			return 31 + rank - 1;
+		case CHIP_CATEGORY_SEASONS:
+			return 34;
+		case CHIP_CATEGORY_FLOWERS:
+			return 35;
+	}
+	return CHIP_CLASS_NONE;
+}
 
-	/* Anything on top? */
-	for(i = -1; i <= 1; ++i)
-		for(j = -1; j <= 1; ++j)
-			if(safe_get(board, y+i, x+j, h) != 0)
-				return 0;
+static int free_set_contains(const free_set_t *set, int slot)
+{
+	return (set->member[slot / 32] >> (slot % 32)) & 1;
+}
+
+static int free_set_lower_bound(const free_set_t *set, int slot)
+{
+	int lo = 0;
+	int hi = set->count;
 
-	/* Anything to the left or right? */
-	l = safe_get(board, y-1, x-2, h-1)
-		|| safe_get(board, y, x-2, h-1)
-		|| safe_get(board, y+1, x-2, h-1);
+	while(lo < hi) {
+		const int mid = (lo + hi) / 2;
+		if(set->slot[mid] < slot)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
 
-	r = safe_get(board, y-1, x+2, h-1)
-		|| safe_get(board, y, x+2, h-1)
-		|| safe_get(board, y+1, x+2, h-1);
+static void free_set_insert(free_set_t *set, int slot)
+{
+	const int i = free_set_lower_bound(set, slot);
 
-	if(l && r)
-		return 0;
+	memmove(&set->slot[i + 1], &set->slot[i], sizeof(int) * (set->count - i));
+	set->slot[i] = slot;
+	++set->count;
+	set->member[slot / 32] |= 1u << (slot % 32);
+}
 
-	return h;
+static void free_set_erase(free_set_t *set, int slot)
+{
+	const int i = free_set_lower_bound(set, slot);
+
+	memmove(&set->slot[i], &set->slot[i + 1], sizeof(int) * (set->count - i - 1));
+	--set->count;
+	set->member[slot / 32] &= ~(1u << (slot % 32));
 }
 
-positions_t* get_selectable_positions(board_t *board)
+/* A chip becoming free fits every free chip of its class, so the pairs change by their count */
+static void add_free_chip(board_t *board, int slot)
 {
-	int i, j;
+	const unsigned char c = board->chip_class[slot];
 
-	positions_t* positions = malloc(sizeof(positions_t));
-	positions->count = 0;
+	board->free_pair_count += board->free_class_count[c];
+	++board->free_class_count[c];
+}
+
+static void remove_free_chip(board_t *board, int slot)
+{
+	const unsigned char c = board->chip_class[slot];
+
+	--board->free_class_count[c];
+	board->free_pair_count -= board->free_class_count[c];
+}
+
+static void update_slot(board_t *board, int slot)
+{
+	const int selectable = layout_selectable(board->layout, board, slot);
+
+	if(selectable && !free_set_contains(&board->free, slot)) {
+		free_set_insert(&board->free, slot);
+		add_free_chip(board, slot);
+	}
+	else if(!selectable && free_set_contains(&board->free, slot)) {
+		free_set_erase(&board->free, slot);
+		remove_free_chip(board, slot);
+	}
+}
+
+/* Only the slot itself and the ones it lies on or sits beside can change */
+static void update_neighbourhood(board_t *board, int slot)
+{
+	int i;
+	const layout_t *layout = board->layout;
+
+	update_slot(board, slot);
+	for(i = layout->below_start[slot]; i < layout->below_start[slot + 1]; ++i)
+		update_slot(board, layout->below[i]);
+	for(i = layout->left_start[slot]; i < layout->left_start[slot + 1]; ++i)
+		update_slot(board, layout->left[i]);
+	for(i = layout->right_start[slot]; i < layout->right_start[slot + 1]; ++i)
+		update_slot(board, layout->right[i]);
+}
 
-	for(i = 0; i < MAX_ROW_COUNT; ++i) {
-		for(j = 0; j < MAX_COL_COUNT; ++j) {
-			int h = selectable(board, i, j);
-			if(h) {
-				positions->positions[positions->count].y = i;
-				positions->positions[positions->count].x = j;
-				positions->positions[positions->count].z = h - 1;
-				++positions->count;
-			}
+void board_init_free_set(board_t *board)
+{
+	int i;
+	const layout_t *layout = board->layout;
+
+	memset(&board->free, 0, sizeof(free_set_t));
+	memset(board->free_class_count, 0, sizeof(board->free_class_count));
+	board->free_pair_count = 0;
+	board->chip_count = 0;
+	board->tile_count = 0;
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(board_removed(board, i))
+			continue;
+
+		++board->chip_count;
+		if(!layout->blocker[i])
+			++board->tile_count;
+		if(layout_selectable(layout, board, i)) {
+			board->free.slot[board->free.count] = i;
+			++board->free.count;
+			board->free.member[i / 32] |= 1u << (i % 32);
+			add_free_chip(board, i);
 		}
 	}
+}
 
-	return positions;
+void board_remove_chip(board_t *board, int slot)
+{
+	board->state.removed[slot / 32] |= 1u << (slot % 32);
+	--board->chip_count;
+	if(!board->layout->blocker[slot])
+		--board->tile_count;
+	update_neighbourhood(board, slot);
+}
+
+void board_restore_chip(board_t *board, int slot, chip_t chip)
+{
+	place_chip(board, slot, chip);
+	++board->chip_count;
+	if(!board->layout->blocker[slot])
+		++board->tile_count;
+	update_neighbourhood(board, slot);
 }
 
-static int colorize(board_t *board, chip_t *pairs, int pile_size, board_t *result_board)
+int free_set_index(const free_set_t *set, int slot)
+{
+	if(!free_set_contains(set, slot))
+		return -1;
+	return free_set_lower_bound(set, slot);
+}
+
+int board_moves(const board_t *board, move_t *moves, int max)
+{
+	int i, c;
+	int count = 0;
+	int bucket_start[CHIP_CLASS_COUNT + 1];
+	int bucket_pos[CHIP_CLASS_COUNT];
+	int bucket[MAX_CHIP_COUNT];
+
+	/* Sort the free chips into buckets by class, keeping layout order inside each */
+	bucket_start[0] = 0;
+	for(c = 0; c < CHIP_CLASS_COUNT; ++c) {
+		bucket_start[c + 1] = bucket_start[c] + board->free_class_count[c];
+		bucket_pos[c] = bucket_start[c];
+	}
+	for(i = 0; i < board->free.count; ++i) {
+		const int slot = board->free.slot[i];
+		bucket[bucket_pos[board->chip_class[slot]]++] = slot;
+	}
+
+	/* Going through the free set in order, pair each chip with the later ones of its bucket */
+	memcpy(bucket_pos, bucket_start, sizeof(bucket_pos));
+	for(i = 0; i < board->free.count; ++i) {
+		const int slot = board->free.slot[i];
+		const int c = board->chip_class[slot];
+		int j;
+
+		for(j = ++bucket_pos[c]; j < bucket_start[c + 1]; ++j) {
+			if(count == max)
+				return count;
+			moves[count].slot1 = slot;
+			moves[count].slot2 = bucket[j];
+			++count;
+		}
+	}
+	return count;
+}
+
+/* The chips left per class, in layout order */
+typedef struct {
+	int size[CHIP_CLASS_COUNT];
+	int slot[CHIP_CLASS_COUNT][MAX_CLASS_SIZE];
+	uint64_t pairs; /* Classes with two chips left */
+} class_slots_t;
+
+static void collect_class_slots(const board_t *board, class_slots_t *classes)
+{
+	int i, c;
+	const layout_t *layout = board->layout;
+
+	memset(classes->size, 0, sizeof(classes->size));
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(board_removed(board, i) || layout->blocker[i])
+			continue;
+		c = board->chip_class[i];
+		if(c < CHIP_CLASS_COUNT && classes->size[c] < MAX_CLASS_SIZE)
+			classes->slot[c][classes->size[c]++] = i;
+	}
+	classes->pairs = 0;
+	for(c = 0; c < CHIP_CLASS_COUNT; ++c)
+		if(classes->size[c] == 2)
+			classes->pairs |= (uint64_t) 1 << c;
+}
+
+/* Whether one of the chips of the class can't be taken off before or after any other one */
+static int class_stranded(const layout_t *layout, const class_slots_t *classes, int c)
 {
 	int i, j;
+	const int *slots = classes->slot[c];
+	const int count = classes->size[c];
 
-	positions_t *positions = get_selectable_positions(board);
+	for(i = 0; i < count && count > 1; ++i) {
+		for(j = 0; j < count; ++j)
+			if(j != i && !layout_lies_on(layout, slots[i], slots[j]) && !layout_lies_on(layout, slots[j], slots[i]))
+				break;
+		if(j == count)
+			return 1;
+	}
+	return 0;
+}
+
+/* A last pair goes in one move, so a chip lying on a chip of another last pair orders the two moves */
+static int pair_goes_before(const layout_t *layout, const class_slots_t *classes, int c, int d)
+{
+	int i;
+
+	for(i = 0; i < 4; ++i)
+		if(layout_lies_on(layout, classes->slot[c][i / 2], classes->slot[d][i % 2]))
+			return 1;
+	return 0;
+}
+
+int board_deadlocked(const board_t *board)
+{
+	int c, d;
+	class_slots_t classes;
+	uint64_t pairs;
+	uint64_t before[CHIP_CLASS_COUNT]; /* Last pairs that have to go before the last pair of the class */
+	const layout_t *layout = board->layout;
+
+	collect_class_slots(board, &classes);
+	for(c = 0; c < CHIP_CLASS_COUNT; ++c)
+		if(class_stranded(layout, &classes, c))
+			return 1;
+
+	pairs = classes.pairs;
+	for(d = 0; d < CHIP_CLASS_COUNT; ++d) {
+		before[d] = 0;
+		if(pairs >> d & 1)
+			for(c = 0; c < CHIP_CLASS_COUNT; ++c)
+				if(c != d && (pairs >> c & 1) && pair_goes_before(layout, &classes, c, d))
+					before[d] |= (uint64_t) 1 << c;
+	}
+
+	/* Take off the pairs with nothing to go before them until none are left or the rest wait on each other */
+	while(pairs) {
+		uint64_t ready = 0;
+
+		for(c = 0; c < CHIP_CLASS_COUNT; ++c)
+			if((pairs >> c & 1) && !(before[c] & pairs))
+				ready |= (uint64_t) 1 << c;
+		if(!ready)
+			return 1;
+		pairs &= ~ready;
+	}
+	return 0;
+}
 
-	if(positions->count < 2) {
-		free(positions);
+int board_deadlocked_by(const board_t *board, const move_t *move)
+{
+	int d, e;
+	class_slots_t classes;
+	uint64_t reached = 0, open;
+	const layout_t *layout = board->layout;
+	const int moved = board->chip_class[move->slot1];
+
+	collect_class_slots(board, &classes);
+	if(class_stranded(layout, &classes, moved))
+		return 1;
+	if(classes.size[moved] != 2)
 		return 0;
+
+	/* Any new circle of last pairs goes through the class that just became one */
+	open = (uint64_t) 1 << moved;
+	while(open) {
+		for(d = 0; !(open >> d & 1); ++d)
+			;
+		open &= ~((uint64_t) 1 << d);
+		for(e = 0; e < CHIP_CLASS_COUNT; ++e) {
+			if(e == d || !(classes.pairs >> e & 1) || (reached >> e & 1) || !pair_goes_before(layout, &classes, d, e))
+				continue;
+			if(e == moved)
+				return 1;
+			reached |= (uint64_t) 1 << e;
+			open |= (uint64_t) 1 << e;
+		}
 	}
+	return 0;
+}
+
+/*
+	The generator takes a full board apart pair by pair following the rules
+	and deals the pile in that order, so the deal can be solved by playing
+	the pairs back. Each level of the search remembers the free slots it
+	started from and the pair it tried last, taking a pair off updates the
+	free set incrementally and backtracking puts it back.
+*/
+typedef struct {
+	int *slot; /* Free slots, shuffled lazily */
+	int count;
+	int shuffled; /* slot[0] ... slot[shuffled-1] are in their final random order */
+	int i, j; /* Pair tried last */
+} generator_level_t;
+
+const generator_limits_t generator_default_limits = {
+	10000, /* node_limit */
+	20, /* restart_limit */
+	2.0 /* time_limit */
+};
+
+/* Open addressing set of board states that could not be taken apart, valid across restarts */
+#define DEAD_STATE_COUNT 1024
 
-	shuffle(positions->positions, positions->count, sizeof(position_t));
+/*
+	The whole search state lives here rather than on the C stack, so a
+	search can stop after a time slice and go on where it left off.
+*/
+struct generator {
+	const layout_t *layout;
+	const board_t *source; /* Only the slots still occupied here are taken apart, NULL for all */
+	board_t board;
+	int tile_count; /* Of the layout, the storage below is sized from it */
+	generator_level_t *level; /* One per pair */
+	int *level_slots; /* Free slots of all levels */
+	int level_count; /* Pairs to take off */
+	int depth; /* Current level of the running attempt */
+	int max_depth; /* Deepest level reached by any attempt, for the progress */
+	int attempt_running;
+	int result; /* Number of levels once finished, 0 on failure or GENERATOR_RUNNING */
+	board_state_t dead[DEAD_STATE_COUNT];
+	unsigned char dead_used[DEAD_STATE_COUNT];
+	int dead_count;
+	chip_t *pile; /* Only if tile_count makes a pile */
+	uint32_t seed;
+	int difficulty;
+	rng_t rng;
+	long nodes; /* Pairs tried in this attempt */
+	long node_limit;
+	int restart_limit;
+	double start;
+	double deadline;
+	double slice_end; /* End of the current time slice, 0 for none */
+	unsigned long ticks; /* Loop iterations, to look at the clock now and then */
+	const int *cancel; /* Set by another thread to stop the search, may be NULL */
+	generator_stats_t stats;
+};
 
-	if(pile_size == 2) {
-		board_set(result_board, &positions->positions[0], pairs[0]);
-		board_set(result_board, &positions->positions[1], pairs[1]);
+#define OUT_OF_BUDGET (-1)
+#define PAUSED (-2)
 
-		free(positions);
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int slice_over(generator_t *gen)
+{
+	return gen->slice_end && ++gen->ticks % 256 == 0 && now() > gen->slice_end;
+}
+
+static int out_of_budget(generator_t *gen)
+{
+	++gen->nodes;
+	if(gen->node_limit && gen->nodes > gen->node_limit)
 		return 1;
+	if(gen->cancel != NULL && __atomic_load_n(gen->cancel, __ATOMIC_RELAXED))
+		return 1;
+	/* Looking at the clock is comparatively expensive */
+	return gen->deadline && gen->nodes % 256 == 0 && now() > gen->deadline;
+}
+
+static int dead_state_find(const generator_t *gen, const board_state_t *state, int *index)
+{
+	int i = board_state_hash(state) % DEAD_STATE_COUNT;
+
+	while(gen->dead_used[i]) {
+		if(!memcmp(&gen->dead[i], state, sizeof(board_state_t)))
+			return 1;
+		i = (i + 1) % DEAD_STATE_COUNT;
 	}
+	*index = i;
+	return 0;
+}
+
+static int is_dead_state(const generator_t *gen, const board_state_t *state)
+{
+	int index;
+	return gen->dead_count != 0 && dead_state_find(gen, state, &index);
+}
+
+static void add_dead_state(generator_t *gen, const board_state_t *state)
+{
+	int index;
 
-	for(i = 0; i < positions->count - 1; ++i) {
-		for(j = i + 1; j < positions->count; ++j) {
-			const position_t* p1 = &positions->positions[i];
-			const position_t* p2 = &positions->positions[j];
+	/* Keep the table sparse, further states are simply searched again */
+	if(gen->dead_count >= DEAD_STATE_COUNT * 3 / 4 || dead_state_find(gen, state, &index))
+		return;
+	gen->dead[index] = *state;
+	gen->dead_used[index] = 1;
+	++gen->dead_count;
+}
 
-			board_set(board, p1, 0);
-			board_set(board, p2, 0);
+static void enter_level(generator_t *gen, int depth)
+{
+	generator_level_t *level = &gen->level[depth];
 
-			if(colorize(board, &pairs[2], pile_size - 2, result_board)) {
-					board_set(result_board, p1, pairs[0]);
-					board_set(result_board, p2, pairs[1]);
+	memcpy(level->slot, gen->board.free.slot, sizeof(int) * gen->board.free.count);
+	level->count = gen->board.free.count;
+	level->shuffled = 0;
+	level->i = 0;
+	level->j = 0;
+}
 
-					free(positions);
-					return 1;
-				}
+/* Fisher-Yates one step at a time, most levels only ever look at their first pair */
+static void shuffle_up_to(generator_t *gen, generator_level_t *level, int index)
+{
+	while(level->shuffled <= index) {
+		const int k = level->shuffled + rng_range(&gen->rng, level->count - level->shuffled);
+		const int t = level->slot[k];
+		level->slot[k] = level->slot[level->shuffled];
+		level->slot[level->shuffled] = t;
+		++level->shuffled;
+	}
+}
 
-			board_set(board, p1, CHIP_PLACEHOLDER);
-			board_set(board, p2, CHIP_PLACEHOLDER);
+/* Moves on to the next pair of the level, returns 0 once all were tried */
+static int next_pair(generator_t *gen, generator_level_t *level)
+{
+	++level->j;
+	if(level->j >= level->count) {
+		++level->i;
+		level->j = level->i + 1;
+	}
+	if(level->i >= level->count - 1)
+		return 0;
+	shuffle_up_to(gen, level, level->j);
+	return 1;
+}
+
+/*
+	Goes on finding an order to take the board apart in, returns the number
+	of levels, 0 if there is none at all, OUT_OF_BUDGET or PAUSED when the
+	time slice is over. A paused search resumes at the same pair.
+*/
+static int take_apart(generator_t *gen)
+{
+	int depth = gen->depth;
+	board_t *board = &gen->board;
+	const int levels = gen->level_count;
+
+	for(;;) {
+		generator_level_t *level = &gen->level[depth];
+
+		if(slice_over(gen)) {
+			gen->depth = depth;
+			return PAUSED;
+		}
+		if(out_of_budget(gen))
+			return OUT_OF_BUDGET;
+
+		if(!next_pair(gen, level)) {
+			/* Dead end, go back and try the next pair one level up */
+			add_dead_state(gen, &board->state);
+			if(depth == 0)
+				return 0;
+			--depth;
+			level = &gen->level[depth];
+			board_restore_chip(board, level->slot[level->j], board->chip[level->slot[level->j]]);
+			board_restore_chip(board, level->slot[level->i], board->chip[level->slot[level->i]]);
+			continue;
 		}
+
+		board_remove_chip(board, level->slot[level->i]);
+		board_remove_chip(board, level->slot[level->j]);
+		if(depth + 1 == levels)
+			return levels;
+
+		/* Without two free tiles the rest can't be taken apart */
+		if(board->free.count < 2 || is_dead_state(gen, &board->state)) {
+			board_restore_chip(board, level->slot[level->j], board->chip[level->slot[level->j]]);
+			board_restore_chip(board, level->slot[level->i], board->chip[level->slot[level->i]]);
+			continue;
+		}
+
+		++depth;
+		if(depth > gen->max_depth)
+			gen->max_depth = depth;
+		enter_level(gen, depth);
 	}
+}
+
+int pile_count(chip_t chip, int tile_count)
+{
+	const int rank = chip & ~CHIP_CATEGORY_MASK;
+	const int pairs = tile_count / PILE_STEP; /* Of every class */
+
+	if(tile_count <= 0 || tile_count % PILE_STEP)
+		return 0;
 
-	free(positions);
+	switch(chip & CHIP_CATEGORY_MASK) {
+		case CHIP_CATEGORY_CHARACTER:
+		case CHIP_CATEGORY_DOTS:
+		case CHIP_CATEGORY_BAMBOO:
+			return rank >= 1 && rank <= 9 ? 2 * pairs : 0;
+		case CHIP_CATEGORY_WINDS:
+			return rank >= 1 && rank <= 4 ? 2 * pairs : 0;
+		case CHIP_CATEGORY_DRAGONS:
+			return rank >= 1 && rank <= 3 ? 2 * pairs : 0;
+		case CHIP_CATEGORY_SEASONS:
+		case CHIP_CATEGORY_FLOWERS:
+			/* The ranks take turns, small piles lack the last ones */
+			return rank >= 1 && rank <= 4 ? (2 * pairs + 4 - rank) / 4 : 0;
+	}
 	return 0;
 }
 
-static void get_pile(chip_t pile[CHIP_COUNT])
+/* Every class twice per PILE_STEP chips, in pairs except for the bonus chips at the end */
+static void get_pile(chip_t *pile, int count)
 {
-	int rank, count;
+	int rank, i;
 	int index = 0;
+	const int class_size = 2 * count / PILE_STEP;
 
 	/* Simples */
 	for(rank = 1; rank <= 9; ++rank) {
-		for(count = 0; count < 4; ++count)
+		for(i = 0; i < class_size; ++i)
 			pile[index++] = CHIP_CATEGORY_CHARACTER | rank;
-		for(count = 0; count < 4; ++count)
+		for(i = 0; i < class_size; ++i)
 			pile[index++] = CHIP_CATEGORY_DOTS | rank;
-		for(count = 0; count < 4; ++count)
+		for(i = 0; i < class_size; ++i)
 			pile[index++] = CHIP_CATEGORY_BAMBOO | rank;
 	}
 	/* Honors */
 	for(rank = 1; rank <= 4; ++rank) {
-		for(count = 0; count < 4; ++count)
+		for(i = 0; i < class_size; ++i)
 			pile[index++] = CHIP_CATEGORY_WINDS | rank;
 	}
 	for(rank = 1; rank <= 3; ++rank) {
-		for(count = 0; count < 4; ++count)
+		for(i = 0; i < class_size; ++i)
 			pile[index++] = CHIP_CATEGORY_DRAGONS | rank;
 	}
 	/* Bonus */
-	for(rank = 1; rank <= 4; ++rank)
-		pile[index++] = CHIP_CATEGORY_SEASONS | rank;
-	for(rank = 1; rank <= 4; ++rank)
-		pile[index++] = CHIP_CATEGORY_FLOWERS | rank;
+	for(i = 0; i < class_size; ++i)
+		pile[index++] = CHIP_CATEGORY_SEASONS | (i % 4 + 1);
+	for(i = 0; i < class_size; ++i)
+		pile[index++] = CHIP_CATEGORY_FLOWERS | (i % 4 + 1);
 }
 
-static void clear_board(board_t *board)
+/* Puts all chips back on the temporary board, the chips don't matter yet */
+static void fill_generator_board(generator_t *gen)
 {
-	int i, j;
+	int i;
+	const layout_t *layout = gen->layout;
 
-	for(i = 0; i < MAX_ROW_COUNT; ++i)
-		for(j = 0; j < MAX_COL_COUNT; ++j)
-			memset(&board->columns[i][j].chips[0], 0, sizeof(chip_t) * MAX_HEIGHT);
+	board_init(&gen->board, layout);
+	for(i = 0; i < layout->slot_count; ++i)
+		if(gen->source == NULL || !board_removed(gen->source, i))
+			place_chip(&gen->board, i, layout->blocker[i] ? CHIP_CATEGORY_BLOCK | 1 : CHIP_CATEGORY_CHARACTER | 1);
+	board_init_free_set(&gen->board);
+}
 
-	board->chip_count = 0;
+/* Starts over on a full board, returns 0 if it can't be taken apart in pairs at all */
+static int start_attempt(generator_t *gen)
+{
+	fill_generator_board(gen);
+	if(gen->board.tile_count == 0 || gen->board.tile_count % 2)
+		return 0;
+
+	gen->level_count = gen->board.tile_count / 2;
+	gen->nodes = 0;
+	gen->depth = 0;
+	enter_level(gen, 0);
+	gen->attempt_running = 1;
+	return 1;
 }
 
-void generate_board(board_t *board, map_t *map)
+static int cancelled(const generator_t *gen)
 {
-	int i;
-	board_t tmp;
-	chip_t pile[CHIP_COUNT];
+	return gen->cancel != NULL && __atomic_load_n(gen->cancel, __ATOMIC_RELAXED);
+}
 
-	/* prepare pile */
-	get_pile(pile);
-	shuffle(&pile[136], 4, sizeof(chip_t)); /* Shuffle seasons */
-	shuffle(&pile[140], 4, sizeof(chip_t)); /* Shuffle flowers */
-	shuffle(pile, 72, 2 * sizeof(chip_t)); /* Shuffle everything, keeping pairs together */
+/*
+	Takes a temporary board apart according to the rules, starting over in
+	a new random order when stuck. Returns the number of levels, 0 or PAUSED.
+*/
+static int search(generator_t *gen)
+{
+	int levels;
+
+	for(;;) {
+		if(!gen->attempt_running && !start_attempt(gen))
+			return 0;
 
-	/* Build temporary board that will be taken apart according to the rules in random order */
-	clear_board(&tmp);
-	for(i = 0; i < CHIP_COUNT; ++i) {
-		const int x = map->chip[i].x;
-		const int y = map->chip[i].y;
-		const int z = map->chip[i].z;
+		levels = take_apart(gen);
+		if(levels == PAUSED)
+			return PAUSED;
 
-		tmp.columns[y][x].chips[z] = CHIP_PLACEHOLDER;
+		gen->attempt_running = 0;
+		gen->stats.nodes += gen->nodes;
+		if(levels != OUT_OF_BUDGET)
+			return levels;
+		if(gen->stats.restarts == gen->restart_limit || (gen->deadline && now() > gen->deadline) || cancelled(gen))
+			return 0;
+		++gen->stats.restarts;
 	}
-	for(i = 0; i < map->block_count; ++i) {
-		const int x = map->block[i].x;
-		const int y = map->block[i].y;
-		const int z = map->block[i].z;
+}
+
+static void shuffle_pile(rng_t *rng, chip_t *pile, int count)
+{
+	const int class_size = 2 * count / PILE_STEP;
 
-		tmp.columns[y][x].chips[z] = CHIP_CATEGORY_BLOCK | 1;
+	get_pile(pile, count);
+	shuffle(rng, &pile[count - 2 * class_size], class_size, sizeof(chip_t)); /* Shuffle seasons */
+	shuffle(rng, &pile[count - class_size], class_size, sizeof(chip_t)); /* Shuffle flowers */
+	shuffle(rng, pile, count / 2, 2 * sizeof(chip_t)); /* Shuffle everything, keeping pairs together */
+}
+
+static generator_t *create_generator(const layout_t *layout, uint32_t seed, int difficulty, const generator_limits_t *limits, double start, const int *cancel)
+{
+	int i;
+	int tile_count = 0;
+	generator_t *gen = (generator_t *) malloc(sizeof(generator_t));
+
+	if(limits == NULL)
+		limits = &generator_default_limits;
+
+	for(i = 0; i < layout->slot_count; ++i)
+		tile_count += !layout->blocker[i];
+	/* A level never has more free slots than there are tiles */
+	gen->tile_count = tile_count;
+	gen->level = (generator_level_t *) malloc(sizeof(generator_level_t) * (tile_count / 2 + 1));
+	gen->level_slots = (int *) malloc(sizeof(int) * (tile_count / 2 + 1) * (tile_count + 1));
+	for(i = 0; i <= tile_count / 2; ++i)
+		gen->level[i].slot = &gen->level_slots[i * (tile_count + 1)];
+	gen->pile = (chip_t *) malloc(tile_count + 1);
+
+	gen->layout = layout;
+	gen->source = NULL;
+	gen->level_count = 0;
+	gen->max_depth = 0;
+	gen->attempt_running = 0;
+	gen->result = GENERATOR_RUNNING;
+	memset(gen->dead_used, 0, sizeof(gen->dead_used));
+	gen->dead_count = 0;
+	gen->seed = seed;
+	gen->difficulty = difficulty;
+	rng_seed(&gen->rng, seed);
+	if(tile_count > 0 && tile_count % PILE_STEP == 0)
+		shuffle_pile(&gen->rng, gen->pile, tile_count);
+	gen->node_limit = limits->node_limit;
+	gen->restart_limit = limits->restart_limit;
+	gen->start = start;
+	gen->deadline = limits->time_limit ? start + limits->time_limit : 0;
+	gen->slice_end = 0;
+	gen->ticks = 0;
+	gen->cancel = cancel;
+	memset(&gen->stats, 0, sizeof(generator_stats_t));
+	return gen;
+}
+
+generator_t *generator_start(map_t *map, uint32_t seed, int difficulty, const generator_limits_t *limits)
+{
+	const layout_t *layout = map_layout(map);
+
+	if(layout == NULL)
+		return NULL;
+	return create_generator(layout, seed, difficulty, limits, now(), NULL);
+}
+
+int generator_step(generator_t *gen, double slice)
+{
+	if(gen->result == GENERATOR_RUNNING) {
+		gen->slice_end = slice > 0 ? now() + slice : 0;
+		gen->result = search(gen);
+		if(gen->result == PAUSED)
+			gen->result = GENERATOR_RUNNING;
 	}
+	return gen->result == GENERATOR_RUNNING ? GENERATOR_RUNNING : gen->result != 0;
+}
+
+double generator_progress(const generator_t *gen)
+{
+	if(gen->result != GENERATOR_RUNNING)
+		return 1;
+	return gen->level_count > 0 ? (double) gen->max_depth / gen->level_count : 0;
+}
 
-	/* Now take the temporary board apart and fill the result board that way */
-	clear_board(board);
-	colorize(&tmp, pile, CHIP_COUNT, board);
+/* Fills the board in the order the generator took its board apart */
+static void deal_pile(const generator_t *gen, const chip_t *pile, int levels, board_t *board)
+{
+	int i;
+	const layout_t *layout = gen->layout;
+
+	board_init(board, layout);
+	for(i = 0; i < levels; ++i) {
+		const generator_level_t *level = &gen->level[i];
+		place_chip(board, level->slot[level->i], pile[2 * i]);
+		place_chip(board, level->slot[level->j], pile[2 * i + 1]);
+	}
 
 	/* Blockers are still missing since they couldn't be taken, add them now */
-	for(i = 0; i < map->block_count; ++i) {
-		const int x = map->block[i].x;
-		const int y = map->block[i].y;
-		const int z = map->block[i].z;
+	for(i = 0; i < layout->slot_count; ++i)
+		if(layout->blocker[i])
+			place_chip(board, i, CHIP_CATEGORY_BLOCK | 1);
+
+	board_init_free_set(board);
+}
+
+/* Plays random legal moves until stuck, returns the number of tiles left */
+static int playout(board_t *board, rng_t *rng)
+{
+	int count;
+	move_t moves[MAX_MOVE_COUNT];
+
+	while((count = board_moves(board, moves, MAX_MOVE_COUNT)) > 0) {
+		const move_t *move = &moves[rng_range(rng, count)];
+		board_remove_chip(board, move->slot1);
+		board_remove_chip(board, move->slot2);
+	}
+	return board->tile_count;
+}
+
+/*
+	Any pile dealt along the order found can be solved, but how easily a
+	player gets lost depends on which pairs share a class: two tiles of a
+	class blocking each other are a trap once the other two are taken. So
+	a few piles are dealt and scored by the tiles random games leave over.
+	Hard deals keep the pile leaving the most tiles, easy ones the pile
+	leaving the fewest, ties go to the earlier pile. Only integers and the
+	generator's RNG go in, so the choice is as reproducible as the deal.
+*/
+#define DIFFICULTY_CANDIDATES 8
+#define DIFFICULTY_PLAYOUTS 16
+
+static void choose_pile(const generator_t *gen, int levels, chip_t *pile)
+{
+	int i, k;
+	int best_score = -1;
+	rng_t rng = gen->rng;
+	chip_t candidate[MAX_CHIP_COUNT];
+	board_t deal, board;
+
+	memcpy(pile, gen->pile, 2 * levels);
+	if(gen->difficulty == DIFFICULTY_NORMAL)
+		return;
+
+	memcpy(candidate, gen->pile, 2 * levels);
+	for(i = 0; i < DIFFICULTY_CANDIDATES; ++i) {
+		int score = 0;
+
+		/* The first candidate is the normal deal */
+		if(i > 0)
+			shuffle(&rng, candidate, levels, 2 * sizeof(chip_t));
+		deal_pile(gen, candidate, levels, &deal);
+		for(k = 0; k < DIFFICULTY_PLAYOUTS; ++k) {
+			board = deal;
+			score += playout(&board, &rng);
+		}
+		if(gen->difficulty == DIFFICULTY_EASY)
+			score = DIFFICULTY_PLAYOUTS * 2 * levels - score;
+		if(score > best_score) {
+			best_score = score;
+			memcpy(pile, candidate, 2 * levels);
+		}
+	}
+}
 
-		board->columns[y][x].chips[z] = CHIP_CATEGORY_BLOCK | 1;
+int generator_deal(const generator_t *gen, board_t *board, generator_stats_t *stats)
+{
+	int result = 0;
+	const int levels = gen->result == GENERATOR_RUNNING ? 0 : gen->result;
+	chip_t pile[MAX_CHIP_COUNT];
+
+	/* Without a pile for the layout there is nothing to deal */
+	if(levels == 0 || 2 * levels != gen->tile_count || gen->tile_count % PILE_STEP) {
+		board_init(board, gen->layout);
+		board_init_free_set(board);
+	}
+	else {
+		choose_pile(gen, levels, pile);
+		deal_pile(gen, pile, levels, board);
+		result = 1;
+	}
+
+	if(stats != NULL) {
+		*stats = gen->stats;
+		stats->seconds = now() - gen->start;
+		stats->seed = gen->seed;
+	}
+	return result;
+}
+
+void generator_free(generator_t *gen)
+{
+	if(gen == NULL)
+		return;
+
+	free(gen->level);
+	free(gen->level_slots);
+	free(gen->pile);
+	free(gen);
+}
+
+int generate_board(board_t *board, map_t *map, uint32_t seed, int difficulty, const generator_limits_t *limits, generator_stats_t *stats)
+{
+	int result;
+	generator_t *gen = generator_start(map, seed, difficulty, limits);
+
+	if(gen == NULL) {
+		board_init(board, NULL);
+		return 0;
+	}
+
+	generator_step(gen, 0);
+	result = generator_deal(gen, board, stats);
+	generator_free(gen);
+	return result;
+}
+
+typedef struct {
+	pthread_mutex_t mutex;
+	int cancel;
+	int winner; /* Index of the first generator that succeeded or -1 */
+} race_t;
+
+typedef struct {
+	race_t *race;
+	generator_t *gen;
+	int index;
+} racer_t;
+
+static void *run_racer(void *arg)
+{
+	racer_t *racer = (racer_t *) arg;
+	race_t *race = racer->race;
+
+	if(generator_step(racer->gen, 0) == 1) {
+		pthread_mutex_lock(&race->mutex);
+		if(race->winner < 0) {
+			race->winner = racer->index;
+			__atomic_store_n(&race->cancel, 1, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_unlock(&race->mutex);
+	}
+	return NULL;
+}
+
+int generate_board_parallel(board_t *board, map_t *map, uint32_t seed, int difficulty, int thread_count, const generator_limits_t *limits, generator_stats_t *stats)
+{
+	int i;
+	int result;
+	int started = 0;
+	race_t race;
+	racer_t racers[GENERATOR_MAX_THREADS];
+	pthread_t threads[GENERATOR_MAX_THREADS];
+	const layout_t *layout = map_layout(map);
+	const double start = now();
+
+	if(thread_count <= 1 || layout == NULL)
+		return generate_board(board, map, seed, difficulty, limits, stats);
+	if(thread_count > GENERATOR_MAX_THREADS)
+		thread_count = GENERATOR_MAX_THREADS;
+
+	pthread_mutex_init(&race.mutex, NULL);
+	race.cancel = 0;
+	race.winner = -1;
+
+	for(i = 0; i < thread_count; ++i) {
+		racers[i].race = &race;
+		racers[i].gen = create_generator(layout, seed + i, difficulty, limits, start, &race.cancel);
+		racers[i].index = i;
+	}
+	for(i = 1; i < thread_count; ++i)
+		if(pthread_create(&threads[i], NULL, run_racer, &racers[i]) == 0)
+			started |= 1 << i;
+	/* The calling thread races as well */
+	run_racer(&racers[0]);
+	for(i = 1; i < thread_count; ++i)
+		if(started & (1 << i))
+			pthread_join(threads[i], NULL);
+
+	result = generator_deal(racers[race.winner >= 0 ? race.winner : 0].gen, board, stats);
+	if(stats != NULL) {
+		stats->nodes = 0;
+		stats->restarts = 0;
+		for(i = 0; i < thread_count; ++i) {
+			stats->nodes += racers[i].gen->stats.nodes;
+			stats->restarts += racers[i].gen->stats.restarts;
+		}
+	}
+
+	for(i = 0; i < thread_count; ++i)
+		generator_free(racers[i].gen);
+	pthread_mutex_destroy(&race.mutex);
+	return result;
+}
+
+int reshuffle_board(board_t *board, uint32_t seed, const generator_limits_t *limits, generator_stats_t *stats)
+{
+	int i, c;
+	int levels;
+	int pair_count = 0;
+	chip_t pairs[MAX_CHIP_COUNT];
+	chip_t pending[CHIP_CLASS_COUNT] = { 0 };
+	const layout_t *layout = board->layout;
+	generator_t *gen = create_generator(layout, seed, DIFFICULTY_NORMAL, limits, now(), NULL);
+
+	/* Only the occupied slots are taken apart, the pile doesn't change */
+	gen->source = board;
+	levels = search(gen);
+
+	if(stats != NULL) {
+		*stats = gen->stats;
+		stats->seconds = now() - gen->start;
+		stats->seed = seed;
+	}
+	if(levels == 0 || levels != board->tile_count / 2) {
+		generator_free(gen);
+		return 0;
+	}
+
+	/* Every class is left an even number of times, pair them up as they come */
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(board_removed(board, i) || layout->blocker[i])
+			continue;
+		c = board->chip_class[i];
+		if(pending[c]) {
+			pairs[2 * pair_count] = pending[c];
+			pairs[2 * pair_count + 1] = board->chip[i];
+			++pair_count;
+			pending[c] = 0;
+		}
+		else {
+			pending[c] = board->chip[i];
+		}
+	}
+	shuffle(&gen->rng, pairs, pair_count, 2 * sizeof(chip_t));
+
+	for(i = 0; i < levels; ++i) {
+		const generator_level_t *level = &gen->level[i];
+		place_chip(board, level->slot[level->i], pairs[2 * i]);
+		place_chip(board, level->slot[level->j], pairs[2 * i + 1]);
+	}
+	board_init_free_set(board);
+
+	generator_free(gen);
+	return 1;
+}
+
+deal_id_t make_deal_id(map_t *map, uint32_t seed, int difficulty)
+{
+	deal_id_t id;
+	const layout_t *layout = map_layout(map);
+
+	id.layout_hash = layout != NULL ? layout_hash(layout) : 0;
+	id.seed = seed;
+	id.difficulty = difficulty;
+	return id;
+}
+
+/* Suffixes of the difficulties, normal deals have none */
+static const char difficulty_suffix[DIFFICULTY_COUNT] = { 0, 'e', 'h' };
+
+void deal_id_format(const deal_id_t *id, char *text)
+{
+	snprintf(text, DEAL_ID_LENGTH + 1, "%08x%08x", id->layout_hash, id->seed);
+	if(id->difficulty > DIFFICULTY_NORMAL && id->difficulty < DIFFICULTY_COUNT) {
+		text[16] = '-';
+		text[17] = difficulty_suffix[id->difficulty];
+		text[18] = '\0';
+	}
+}
+
+int deal_id_parse(const char *text, deal_id_t *id)
+{
+	char hash[9];
+	const size_t length = strlen(text);
+
+	if((length != 16 && length != 18) || strspn(text, "0123456789abcdefABCDEF") != 16)
+		return 0;
+
+	id->difficulty = DIFFICULTY_NORMAL;
+	if(length == 18) {
+		for(id->difficulty = DIFFICULTY_NORMAL + 1; id->difficulty < DIFFICULTY_COUNT; ++id->difficulty)
+			if(text[16] == '-' && text[17] == difficulty_suffix[id->difficulty])
+				break;
+		if(id->difficulty == DIFFICULTY_COUNT)
+			return 0;
+	}
+
+	memcpy(hash, text, 8);
+	hash[8] = '\0';
+	id->layout_hash = (uint32_t) strtoul(hash, NULL, 16);
+	memcpy(hash, &text[8], 8);
+	id->seed = (uint32_t) strtoul(hash, NULL, 16);
+	return 1;
+}
+
+int generate_deal(board_t *board, map_t *map, const deal_id_t *id)
+{
+	generator_limits_t limits = generator_default_limits;
+	const layout_t *layout = map_layout(map);
+
+	if(layout == NULL || layout_hash(layout) != id->layout_hash) {
+		board_init(board, layout);
+		return 0;
 	}
 
-	board->chip_count = CHIP_COUNT + map->block_count;
+	/* The clock could only make it fail */
+	limits.time_limit = 0;
+	return generate_board(board, map, id->seed, id->difficulty, &limits, NULL);
 }
 
 int fits(chip_t a, chip_t b)
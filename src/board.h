@@ -1,6 +1,8 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <stdint.h>
+
 /*
 	category - 4-bit
 	rank - 4-bit
@@ -10,7 +12,17 @@ typedef unsigned char chip_t;
 #define MAX_ROW_COUNT 24
 #define MAX_COL_COUNT 40
 #define MAX_HEIGHT 16
-#define CHIP_COUNT 144
+
+/*
+	Piles come in multiples of half a set, one pair of every class: 72
+	tiles for small layouts, 144 for a full set and 288 for two sets.
+	Storage that depends on the map is sized from it, the maxima only
+	bound the boards, which are copied by value.
+*/
+#define PILE_STEP 72
+#define CHIP_COUNT 144 /* Of a full set, maps without a size hold one */
+#define MAX_CHIP_COUNT 288
+#define MAX_SLOT_COUNT 512 /* Chips and blockers */
 
 #define CHIP_CATEGORY_MASK 0xf0
 #define CHIP_CATEGORY_CHARACTER 0x10
@@ -27,16 +39,65 @@ typedef unsigned char chip_t;
 
 #define CHIP_PLACEHOLDER 0xff
 
+/*
+	Chips that fit each other share a class: one per simple, wind and
+	dragon, plus one for all seasons and one for all flowers.
+*/
+#define CHIP_CLASS_COUNT 36
+#define CHIP_CLASS_NONE 0xff /* Blockers and empty slots */
+
+unsigned char chip_class(chip_t chip);
+
+/* How often the chip is in a pile of tile_count chips, 0 for piles of other sizes */
+int pile_count(chip_t chip, int tile_count);
 
+typedef struct layout layout_t;
+
+#define SLOT_WORDS (MAX_SLOT_COUNT / 32)
+
+/* Selectable slots, kept in layout order */
+typedef struct {
+	int slot[MAX_CHIP_COUNT];
+	int count;
+	unsigned int member[SLOT_WORDS];
+} free_set_t;
+
+/* The part of a board that changes while playing, cheap to copy and hash */
 typedef struct {
-	chip_t chips[MAX_HEIGHT];
-} column_t;
+	unsigned int removed[SLOT_WORDS];
+} board_state_t;
 
+/*
+	Chips are stored per slot of the layout and stay in place when taken
+	off, so a removed chip is just a bit in the state.
+*/
 typedef struct {
-	column_t columns[MAX_ROW_COUNT][MAX_COL_COUNT];
-	int chip_count;
+	const layout_t *layout;
+	chip_t chip[MAX_SLOT_COUNT];
+	unsigned char chip_class[MAX_SLOT_COUNT]; /* chip_class() of chip */
+	board_state_t state;
+	int chip_count; /* Including blockers */
+	int tile_count; /* Without blockers, the game is won at zero */
+	free_set_t free;
+	unsigned char free_class_count[CHIP_CLASS_COUNT]; /* Free chips per class */
+	int free_pair_count; /* Fitting pairs among the free chips, zero when stuck */
 } board_t;
 
+static inline int board_removed(const board_t *board, int slot)
+{
+	return (board->state.removed[slot / 32] >> (slot % 32)) & 1;
+}
+
+static inline chip_t board_chip(const board_t *board, int slot)
+{
+	return board_removed(board, slot) ? 0 : board->chip[slot];
+}
+
+/* Sets up an empty board with all slots removed */
+void board_init(board_t *board, const layout_t *layout);
+
+unsigned int board_state_hash(const board_state_t *state);
+
 typedef struct {
 	unsigned char x, y, z;
 } position_t;
@@ -44,27 +105,165 @@ typedef struct {
 int position_equal(const position_t *pos1, const position_t *pos2);
 
 typedef struct {
-	position_t positions[CHIP_COUNT];
+	position_t positions[MAX_CHIP_COUNT];
 	int count;
 } positions_t;
 
 positions_t* get_selectable_positions(board_t *board);
 
+/* Access by position, only positions of the layout hold chips */
 chip_t board_get(const board_t *board, const position_t *pos);
 void board_set(board_t *board, const position_t *pos, chip_t chip);
 
+/* Recomputes the chip counts, the free set and its class counts from scratch */
+void board_init_free_set(board_t *board);
+/* Take a chip off or put it back, updating the free set and counts around the slot only */
+void board_remove_chip(board_t *board, int slot);
+void board_restore_chip(board_t *board, int slot, chip_t chip);
+
+/* Position of a slot in the free set, -1 if it is not free */
+int free_set_index(const free_set_t *set, int slot);
+
+/* A legal move, slot1 comes before slot2 in layout order */
+typedef struct {
+	int slot1;
+	int slot2;
+} move_t;
+
+/* Enough for the largest pile, where every class has the same number of chips */
+#define MAX_CLASS_SIZE (MAX_CHIP_COUNT / CHIP_CLASS_COUNT)
+#define MAX_MOVE_COUNT (CHIP_CLASS_COUNT * MAX_CLASS_SIZE * (MAX_CLASS_SIZE - 1) / 2)
+
+/*
+	Writes up to max legal moves ordered by their first and then their
+	second slot, returns how many were written. Works on per-class
+	buckets of the free chips without allocating, so the time is linear
+	in the number of free chips and moves.
+*/
+int board_moves(const board_t *board, move_t *moves, int max);
+
+/*
+	Recognises some lost boards without searching, in microseconds: a
+	class with a chip that lies on or under every other chip of its class
+	left, and classes with their last pair left whose chips lie on each
+	other's in a circle. Returns 1 if the board can't be won, 0 if it
+	doesn't know. Assumes the board was played from a full one.
+*/
+int board_deadlocked(const board_t *board);
+/*
+	The same after the move was made on a board that wasn't deadlocked,
+	looking only at what the move changed: the class it took a pair of.
+*/
+int board_deadlocked_by(const board_t *board, const move_t *move);
+
 /*******************************************************/
 
 typedef struct tag_map {
 	char *name;
 	unsigned char row_count;
 	unsigned char col_count;
-	position_t chip[CHIP_COUNT]; /* Mahjong tiles */
+	position_t *chip; /* Mahjong tiles */
+	unsigned int chip_count; /* A multiple of PILE_STEP */
 	position_t *block; /* Blocker tiles */
 	unsigned int block_count;
+	layout_t *layout; /* Compiled on first use, see map_layout() */
 } map_t;
 
-void generate_board(board_t *board, map_t *map);
+typedef struct {
+	long node_limit; /* Pairs tried per attempt before starting over, 0 for no limit */
+	int restart_limit; /* Attempts after the first one */
+	double time_limit; /* Seconds for all attempts, 0 for no limit */
+} generator_limits_t;
+
+extern const generator_limits_t generator_default_limits;
+
+typedef struct {
+	long nodes; /* Pairs tried over all attempts */
+	int restarts;
+	double seconds;
+	uint32_t seed; /* Of the search that found the deal */
+} generator_stats_t;
+
+/*
+	Targets for how easily a player gets lost in a deal. Normal deals take
+	the first pile that fits, the others pick among a few piles by the
+	outcome of random games on them, which takes a few milliseconds.
+*/
+#define DIFFICULTY_NORMAL 0
+#define DIFFICULTY_EASY 1
+#define DIFFICULTY_HARD 2
+#define DIFFICULTY_COUNT 3
+
+/*
+	Deals the pile so that the board can be solved. Each attempt takes the
+	board apart in a fresh random order until it succeeds or runs out of
+	budget. Returns 0 and leaves the board empty if no deal was found,
+	limits may be NULL for the defaults and stats may be NULL.
+
+	All randomness comes from the seed, so the same seed, map and node and
+	restart limits give the same deal on every build. Running out of time
+	or being cancelled only ever fails a search, it never changes a deal.
+*/
+int generate_board(board_t *board, map_t *map, uint32_t seed, int difficulty, const generator_limits_t *limits, generator_stats_t *stats);
+
+/*
+	Deals the chips left on the board anew over the slots they occupy so
+	that the rest of the game can be solved, taking apart only what is
+	left. Removed chips stay as they are. Returns 0 and leaves the board
+	as it was if no order was found within the limits.
+*/
+int reshuffle_board(board_t *board, uint32_t seed, const generator_limits_t *limits, generator_stats_t *stats);
+
+/*
+	A deal is named by the layout it was made for and its seed, written as
+	16 hex digits, followed by -e or -h for easy and hard deals. Deal IDs
+	assume generator_default_limits.
+*/
+typedef struct {
+	uint32_t layout_hash;
+	uint32_t seed;
+	int difficulty;
+} deal_id_t;
+
+#define DEAL_ID_LENGTH 18 /* At most */
+
+deal_id_t make_deal_id(map_t *map, uint32_t seed, int difficulty);
+/* text must hold DEAL_ID_LENGTH + 1 characters */
+void deal_id_format(const deal_id_t *id, char *text);
+int deal_id_parse(const char *text, deal_id_t *id);
+/* Makes the deal again, returns 0 if the ID is for another map or fails */
+int generate_deal(board_t *board, map_t *map, const deal_id_t *id);
+
+/*
+	The same search in steps, for callers that have to stay responsive on
+	a single thread. generator_step() searches for about slice seconds
+	(0 for as long as it takes) and returns GENERATOR_RUNNING until the
+	search is over, then 1 if a deal was found and 0 if not. The time limit
+	counts from generator_start(), pauses between the steps included.
+*/
+typedef struct generator generator_t;
+
+#define GENERATOR_RUNNING (-1)
+
+/* Returns NULL on invalid maps, limits may be NULL */
+generator_t *generator_start(map_t *map, uint32_t seed, int difficulty, const generator_limits_t *limits);
+int generator_step(generator_t *gen, double slice);
+/* Share of the levels the deepest attempt got through so far, 0 to 1 */
+double generator_progress(const generator_t *gen);
+/* Deals the pile once the search succeeded, returns 0 and leaves the board empty otherwise */
+int generator_deal(const generator_t *gen, board_t *board, generator_stats_t *stats);
+void generator_free(generator_t *gen);
+
+#define GENERATOR_MAX_THREADS 16
+
+/*
+	Races independent searches on thread_count threads (the calling one
+	included) and deals from the first one that succeeds, the others are
+	cancelled. The limits apply to each search, the stats sum up all of
+	them. Search i uses seed + i, the stats tell which one won. Call
+	map_layout() once before using a map from several threads.
+*/
+int generate_board_parallel(board_t *board, map_t *map, uint32_t seed, int difficulty, int thread_count, const generator_limits_t *limits, generator_stats_t *stats);
 
 int fits(chip_t a, chip_t b);
 
@@ -11,17 +11,78 @@ static inline void swap_b(void *e1, void *e2, size_t size, void *b)
 	}
 }
 
+static inline uint32_t rotl(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+/* splitmix64 spreads the seed over the state, which must not be all zero */
+void rng_seed(rng_t *rng, uint64_t seed)
+{
+	int i;
+
+	for(i = 0; i < 4; i += 2) {
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		z ^= z >> 31;
+		rng->s[i] = (uint32_t) z;
+		rng->s[i + 1] = (uint32_t) (z >> 32);
+	}
+}
+
+uint32_t rng_next(rng_t *rng)
+{
+	uint32_t *s = rng->s;
+	const uint32_t result = rotl(s[1] * 5, 7) * 9;
+	const uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return result;
+}
+
+/* Lemire's multiply and shift, rejecting the few values that would be overrepresented */
+int rng_range(rng_t *rng, int m)
+{
+	const uint32_t range = (uint32_t) m;
+	uint64_t product = (uint64_t) rng_next(rng) * range;
+
+	if((uint32_t) product < range) {
+		const uint32_t threshold = -range % range;
+		while((uint32_t) product < threshold)
+			product = (uint64_t) rng_next(rng) * range;
+	}
+	return (int) (product >> 32);
+}
+
+static rng_t g_rng = { { 1, 2, 3, 4 } };
+
+void rrand_seed(uint64_t seed)
+{
+	rng_seed(&g_rng, seed);
+}
+
 int rrand(int m)
 {
-	return rand() % m;
+	return rng_range(&g_rng, m);
+}
+
+uint32_t rrand_u32(void)
+{
+	return rng_next(&g_rng);
 }
 
-void shuffle(void *array, size_t nmemb, size_t size)
+void shuffle(rng_t *rng, void *array, size_t nmemb, size_t size)
 {
 	void *temp = malloc(size);
 	size_t n = nmemb;
 	while(n > 1) {
-		size_t k = rrand(n);
+		size_t k = rng_range(rng, n);
 		swap_b((char*)array + (n-1)*size, (char*)array + k*size, size, temp);
 		--n;
 	}
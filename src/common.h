@@ -2,6 +2,7 @@
 #define COMMON_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #define SCREEN_WIDTH (ScreenWidth())
 #define SCREEN_HEIGHT (ScreenHeight())
@@ -16,9 +17,25 @@ static inline int max_int(int x, int y)
   return x > y ? x : y;
 }
 
+/*
+	xoshiro128**, the same sequence from the same seed on every build.
+	Each user keeps its own state, so threads don't share any.
+*/
+typedef struct {
+	uint32_t s[4];
+} rng_t;
+
+void rng_seed(rng_t *rng, uint64_t seed);
+uint32_t rng_next(rng_t *rng);
+/* Uniform in 0 ... m-1, without the bias of taking the remainder */
+int rng_range(rng_t *rng, int m);
+
+/* Process wide generator for the interface, not thread safe */
+void rrand_seed(uint64_t seed);
 int rrand(int m);
+uint32_t rrand_u32(void);
 
-void shuffle(void *obj, size_t nmemb, size_t size);
+void shuffle(rng_t *rng, void *obj, size_t nmemb, size_t size);
 void topological_sort(void *array, size_t nmemb, size_t size, int (*has_edge)(const void*, const void*));
 
 #endif
@@ -0,0 +1,118 @@
+#include <string.h>
+#include <time.h>
+#include "hint.h"
+#include "beam.h"
+#include "common.h"
+#include "layout.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void take(board_t *board, const move_t *move)
+{
+	board_remove_chip(board, move->slot1);
+	board_remove_chip(board, move->slot2);
+}
+
+static void put_back(board_t *board, const move_t *move)
+{
+	board_restore_chip(board, move->slot2, board->chip[move->slot2]);
+	board_restore_chip(board, move->slot1, board->chip[move->slot1]);
+}
+
+/* Moves the hint up or down to where its score belongs, after the ones with the same score */
+static void settle(hint_list_t *list, int i)
+{
+	const hint_t hint = list->hint[i];
+
+	while(i > 0 && list->hint[i - 1].score < hint.score) {
+		list->hint[i] = list->hint[i - 1];
+		--i;
+	}
+	while(i + 1 < list->count && list->hint[i + 1].score >= hint.score) {
+		list->hint[i] = list->hint[i + 1];
+		++i;
+	}
+	list->hint[i] = hint;
+}
+
+void hint_rank(hint_list_t *list, const board_t *board)
+{
+	int i, count;
+	move_t moves[MAX_MOVE_COUNT];
+	unsigned char class_left[CHIP_CLASS_COUNT];
+	board_t work = *board;
+	const layout_t *layout = board->layout;
+
+	memset(class_left, 0, sizeof(class_left));
+	for(i = 0; i < layout->slot_count; ++i)
+		if(!board_removed(board, i) && !layout->blocker[i])
+			++class_left[board->chip_class[i]];
+
+	count = board_moves(board, moves, MAX_MOVE_COUNT);
+	for(i = 0; i < count; ++i) {
+		hint_t *hint = &list->hint[i];
+		const int c = board->chip_class[moves[i].slot1];
+
+		hint->move = moves[i];
+		hint->looked_ahead = 0;
+		take(&work, &moves[i]);
+		if(board_deadlocked_by(&work, &moves[i])) {
+			hint->score = HINT_LOSES;
+			hint->looked_ahead = 1;
+		}
+		else {
+			/* Chips freed by the move, the two taken off were free before */
+			hint->score = 64 * (work.free.count - board->free.count + 2)
+				+ 8 * (work.free_pair_count - board->free_pair_count)
+				+ layout->z[moves[i].slot1] + layout->z[moves[i].slot2]
+				/* When all chips of a class are free, taking two of them can't hurt */
+				+ (class_left[c] == board->free_class_count[c]);
+		}
+		put_back(&work, &moves[i]);
+		list->count = i + 1;
+		settle(list, i);
+	}
+
+	list->count = count;
+	list->looked_ahead = 0;
+	for(i = 0; i < count; ++i)
+		list->looked_ahead += list->hint[i].looked_ahead;
+	list->ready = 1;
+}
+
+int hint_look_ahead(hint_list_t *list, const board_t *board, double slice)
+{
+	const double start = now();
+	beam_limits_t limits = beam_default_limits;
+	board_t work;
+
+	if(!list->ready)
+		hint_rank(list, board);
+	limits.time_limit = HINT_LOOK_AHEAD_TIME;
+
+	while(list->looked_ahead < list->count) {
+		int i, result;
+
+		for(i = 0; list->hint[i].looked_ahead; ++i)
+			;
+		work = *board;
+		take(&work, &list->hint[i].move);
+		result = solve_board_beam(&work, &limits, NULL, NULL);
+		list->hint[i].looked_ahead = 1;
+		++list->looked_ahead;
+		if(result == 1)
+			list->hint[i].score += HINT_WINS;
+		else if(result == 0)
+			list->hint[i].score = HINT_LOSES;
+		settle(list, i);
+
+		if(slice && now() - start >= slice)
+			break;
+	}
+	return list->looked_ahead < list->count;
+}
@@ -0,0 +1,42 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include "board.h"
+
+/*
+	The legal moves of a position ranked for hints, best first. Ranking
+	the moves by what they do to the board takes microseconds: moves that
+	leave a class with no way to be cleared come last, the others are
+	ordered by the chips they free, then by the pairs they make and how
+	high the chips are. Looking ahead from each move, in that order, with
+	a short beam search then moves the ones known to lead to a win to the
+	front and the ones known to lose to the back. Looking ahead is done a
+	slice at a time, so it fits in the idle time between two moves.
+*/
+typedef struct {
+	move_t move;
+	int score;
+	int looked_ahead;
+} hint_t;
+
+typedef struct {
+	hint_t hint[MAX_MOVE_COUNT];
+	int count;
+	int looked_ahead; /* Moves looked ahead from */
+	int ready; /* Ranked for the current position */
+} hint_list_t;
+
+#define HINT_LOOK_AHEAD_TIME 0.02 /* Seconds per move at most */
+#define HINT_WINS 1000000 /* Added to the score of moves known to lead to a win */
+#define HINT_LOSES (-1000000) /* Score of moves known to lose */
+
+/* Ranks the moves of the board by what they do to it */
+void hint_rank(hint_list_t *list, const board_t *board);
+
+/*
+	Looks ahead from the moves not looked at yet for about slice seconds,
+	re-ranking them as it goes. Returns 0 once every move was looked at.
+*/
+int hint_look_ahead(hint_list_t *list, const board_t *board, double slice);
+
+#endif
@@ -0,0 +1,298 @@
+#include <string.h>
+#include "layout.h"
+#include "common.h"
+
+#define NO_SLOT (-1)
+
+typedef short slot_grid_t[MAX_ROW_COUNT][MAX_COL_COUNT][MAX_HEIGHT];
+
+typedef enum {
+	ABOVE,
+	BELOW,
+	LEFT,
+	RIGHT
+} relation_t;
+
+typedef struct {
+	position_t pos;
+	unsigned char blocker;
+} layout_slot_t;
+
+static int grid_get(slot_grid_t grid, int y, int x, int z)
+{
+	if(y < 0 || y >= MAX_ROW_COUNT)
+		return NO_SLOT;
+	if(x < 0 || x >= MAX_COL_COUNT)
+		return NO_SLOT;
+	if(z < 0 || z >= MAX_HEIGHT)
+		return NO_SLOT;
+
+	return grid[y][x][z];
+}
+
+static int add(int s, int *list, int count)
+{
+	if(s != NO_SLOT && list != NULL)
+		list[count] = s;
+	return s != NO_SLOT;
+}
+
+/* Collects the neighbours of a slot into list (if not NULL), returns their count */
+static int collect(slot_grid_t grid, const position_t *pos, relation_t relation, int *list)
+{
+	int i, j, k;
+	int count = 0;
+
+	switch(relation) {
+		case ABOVE:
+			for(i = -1; i <= 1; ++i)
+				for(j = -1; j <= 1; ++j)
+					count += add(grid_get(grid, pos->y + i, pos->x + j, pos->z + 1), list, count);
+			/* A chip further up the same column hides this one even across a gap */
+			for(k = pos->z + 2; k < MAX_HEIGHT; ++k)
+				count += add(grid_get(grid, pos->y, pos->x, k), list, count);
+			break;
+
+		case BELOW:
+			for(i = -1; i <= 1; ++i)
+				for(j = -1; j <= 1; ++j)
+					count += add(grid_get(grid, pos->y + i, pos->x + j, pos->z - 1), list, count);
+			for(k = pos->z - 2; k >= 0; --k)
+				count += add(grid_get(grid, pos->y, pos->x, k), list, count);
+			break;
+
+		case LEFT:
+		case RIGHT:
+			for(i = -1; i <= 1; ++i)
+				count += add(grid_get(grid, pos->y + i, pos->x + (relation == LEFT ? -2 : 2), pos->z), list, count);
+			break;
+	}
+
+	return count;
+}
+
+static int *build_relation(slot_grid_t grid, const layout_t *layout, relation_t relation, int **start)
+{
+	int i;
+	int *list;
+
+	*start = malloc(sizeof(int) * (layout->slot_count + 1));
+	(*start)[0] = 0;
+	for(i = 0; i < layout->slot_count; ++i) {
+		const position_t pos = layout_position(layout, i);
+		(*start)[i + 1] = (*start)[i] + collect(grid, &pos, relation, NULL);
+	}
+
+	list = malloc(sizeof(int) * ((*start)[layout->slot_count] + 1));
+	for(i = 0; i < layout->slot_count; ++i) {
+		const position_t pos = layout_position(layout, i);
+		collect(grid, &pos, relation, &list[(*start)[i]]);
+	}
+
+	return list;
+}
+
+/* Goes up level by level, so the sets of the slots below are complete when a slot takes them over */
+static unsigned int *build_beneath(const layout_t *layout)
+{
+	int i, j, w, z;
+	unsigned int *beneath = calloc((size_t) layout->slot_count * SLOT_WORDS, sizeof(unsigned int));
+
+	for(z = 0; z < MAX_HEIGHT; ++z) {
+		for(i = 0; i < layout->slot_count; ++i) {
+			unsigned int *set = &beneath[i * SLOT_WORDS];
+
+			if(layout->z[i] != z)
+				continue;
+			for(j = layout->below_start[i]; j < layout->below_start[i + 1]; ++j) {
+				const int b = layout->below[j];
+
+				set[b / 32] |= 1u << (b % 32);
+				for(w = 0; w < SLOT_WORDS; ++w)
+					set[w] |= beneath[b * SLOT_WORDS + w];
+			}
+		}
+	}
+	return beneath;
+}
+
+/* Reading order: pairs of rows from top to bottom, each from left to right */
+static int reading_key(const position_t *pos)
+{
+	return ((pos->y - 1) / 2 * MAX_COL_COUNT + pos->x) * MAX_ROW_COUNT * MAX_HEIGHT + pos->y * MAX_HEIGHT + pos->z;
+}
+
+static int cmp_slot(const void *p1, const void *p2)
+{
+	const layout_slot_t *s1 = p1;
+	const layout_slot_t *s2 = p2;
+	return reading_key(&s1->pos) - reading_key(&s2->pos);
+}
+
+int layout_build(layout_t *layout, const position_t *positions, const unsigned char *blocker, int count)
+{
+	int i;
+	slot_grid_t *grid;
+	layout_slot_t *slots;
+
+	memset(layout, 0, sizeof(layout_t));
+	if(count > MAX_SLOT_COUNT)
+		return 0;
+
+	slots = malloc(sizeof(layout_slot_t) * count);
+	for(i = 0; i < count; ++i) {
+		slots[i].pos = positions[i];
+		slots[i].blocker = blocker[i];
+	}
+	qsort(slots, count, sizeof(layout_slot_t), cmp_slot);
+
+	grid = malloc(sizeof(slot_grid_t));
+	memset(grid, 0xff, sizeof(slot_grid_t));
+	for(i = 0; i < count; ++i) {
+		const position_t *pos = &slots[i].pos;
+		if(pos->y >= MAX_ROW_COUNT || pos->x >= MAX_COL_COUNT || pos->z >= MAX_HEIGHT || (*grid)[pos->y][pos->x][pos->z] != NO_SLOT) {
+			free(slots);
+			free(grid);
+			return 0;
+		}
+		(*grid)[pos->y][pos->x][pos->z] = i;
+	}
+
+	layout->slot_count = count;
+	layout->x = malloc(count);
+	layout->y = malloc(count);
+	layout->z = malloc(count);
+	layout->blocker = malloc(count);
+	memset(layout->column_start, 0xff, sizeof(layout->column_start));
+	for(i = 0; i < count; ++i) {
+		const position_t *pos = &slots[i].pos;
+		layout->x[i] = pos->x;
+		layout->y[i] = pos->y;
+		layout->z[i] = pos->z;
+		layout->blocker[i] = slots[i].blocker;
+		if(layout->column_start[pos->y][pos->x] == NO_SLOT)
+			layout->column_start[pos->y][pos->x] = i;
+		++layout->column_height[pos->y][pos->x];
+	}
+	free(slots);
+
+	layout->above = build_relation(*grid, layout, ABOVE, &layout->above_start);
+	layout->below = build_relation(*grid, layout, BELOW, &layout->below_start);
+	layout->left = build_relation(*grid, layout, LEFT, &layout->left_start);
+	layout->right = build_relation(*grid, layout, RIGHT, &layout->right_start);
+	layout->beneath = build_beneath(layout);
+
+	free(grid);
+	return 1;
+}
+
+void layout_free(layout_t *layout)
+{
+	free(layout->x);
+	free(layout->y);
+	free(layout->z);
+	free(layout->blocker);
+	free(layout->above_start);
+	free(layout->above);
+	free(layout->below_start);
+	free(layout->below);
+	free(layout->left_start);
+	free(layout->left);
+	free(layout->right_start);
+	free(layout->right);
+	free(layout->beneath);
+	memset(layout, 0, sizeof(layout_t));
+}
+
+const layout_t *map_layout(map_t *map)
+{
+	unsigned int i;
+	int count;
+	position_t *positions;
+	unsigned char *blocker;
+
+	if(map->layout != NULL)
+		return map->layout;
+
+	if(map->chip_count == 0 || map->chip_count % PILE_STEP || map->chip_count > MAX_CHIP_COUNT)
+		return NULL;
+
+	count = map->chip_count + map->block_count;
+	positions = malloc(sizeof(position_t) * count);
+	blocker = calloc(count, 1);
+	memcpy(positions, map->chip, sizeof(position_t) * map->chip_count);
+	for(i = 0; i < map->block_count; ++i) {
+		positions[map->chip_count + i] = map->block[i];
+		blocker[map->chip_count + i] = 1;
+	}
+
+	map->layout = malloc(sizeof(layout_t));
+	if(!layout_build(map->layout, positions, blocker, count)) {
+		free(map->layout);
+		map->layout = NULL;
+	}
+
+	free(positions);
+	free(blocker);
+	return map->layout;
+}
+
+static unsigned int hash_bytes(unsigned int hash, const unsigned char *bytes, int count)
+{
+	int i;
+
+	for(i = 0; i < count; ++i) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* FNV-1a */
+unsigned int layout_hash(const layout_t *layout)
+{
+	unsigned int hash = 2166136261u;
+
+	hash = hash_bytes(hash, layout->x, layout->slot_count);
+	hash = hash_bytes(hash, layout->y, layout->slot_count);
+	hash = hash_bytes(hash, layout->z, layout->slot_count);
+	return hash_bytes(hash, layout->blocker, layout->slot_count);
+}
+
+int layout_find(const layout_t *layout, const position_t *pos)
+{
+	int i;
+	int start;
+
+	if(pos->y >= MAX_ROW_COUNT || pos->x >= MAX_COL_COUNT)
+		return NO_SLOT;
+
+	start = layout->column_start[pos->y][pos->x];
+	for(i = 0; i < layout->column_height[pos->y][pos->x]; ++i)
+		if(layout->z[start + i] == pos->z)
+			return start + i;
+	return NO_SLOT;
+}
+
+int layout_selectable(const layout_t *layout, const board_t *board, int slot)
+{
+	int i;
+	int l = 0, r = 0;
+
+	/* No chip or a blocker? */
+	if(layout->blocker[slot] || board_removed(board, slot))
+		return 0;
+
+	/* Anything on top? */
+	for(i = layout->above_start[slot]; i < layout->above_start[slot + 1]; ++i)
+		if(!board_removed(board, layout->above[i]))
+			return 0;
+
+	/* Anything to the left or right? */
+	for(i = layout->left_start[slot]; i < layout->left_start[slot + 1] && !l; ++i)
+		l = !board_removed(board, layout->left[i]);
+	for(i = layout->right_start[slot]; i < layout->right_start[slot + 1] && !r; ++i)
+		r = !board_removed(board, layout->right[i]);
+
+	return !(l && r);
+}
@@ -0,0 +1,73 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "board.h"
+
+/*
+	Blocking graph of a map, compiled once so selectability can be decided
+	per slot instead of by probing the whole grid.
+
+	Slots are the positions of all tiles and blockers in reading order
+	(pairs of rows from top to bottom, each from left to right), so sorting
+	slot numbers sorts positions the way they are traversed on screen.
+	For every slot the graph lists the slots on top of it, the slots it
+	lies on and the slots directly to its left and right, stored as
+	adjacency lists with per-slot start offsets (the lists of slot i are
+	list[start[i]] ... list[start[i+1]-1]). The slots a slot lies on,
+	directly or through others, are also kept as a bit set per slot.
+
+	Positions are kept as separate coordinate arrays. The slots of a column
+	are consecutive, so a position is found through the first slot and the
+	number of slots of its column.
+*/
+struct layout {
+	int slot_count;
+	unsigned char *x;
+	unsigned char *y;
+	unsigned char *z;
+	unsigned char *blocker;
+
+	short column_start[MAX_ROW_COUNT][MAX_COL_COUNT];
+	unsigned char column_height[MAX_ROW_COUNT][MAX_COL_COUNT];
+
+	int *above_start;
+	int *above;
+	int *below_start;
+	int *below;
+	int *left_start;
+	int *left;
+	int *right_start;
+	int *right;
+	unsigned int *beneath; /* SLOT_WORDS words per slot */
+};
+
+int layout_build(layout_t *layout, const position_t *positions, const unsigned char *blocker, int count);
+void layout_free(layout_t *layout);
+
+/* Compiles the map's layout on first use, returns NULL on invalid maps */
+const layout_t *map_layout(map_t *map);
+
+/* Identifies a layout by its slots, equal hashes mean the same slot numbering */
+unsigned int layout_hash(const layout_t *layout);
+
+/* Returns the slot at the position or -1 */
+int layout_find(const layout_t *layout, const position_t *pos);
+
+static inline position_t layout_position(const layout_t *layout, int slot)
+{
+	position_t pos;
+	pos.x = layout->x[slot];
+	pos.y = layout->y[slot];
+	pos.z = layout->z[slot];
+	return pos;
+}
+
+/* Whether upper can only be taken off before lower, because it lies on it directly or through others */
+static inline int layout_lies_on(const layout_t *layout, int upper, int lower)
+{
+	return (layout->beneath[upper * SLOT_WORDS + lower / 32] >> (lower % 32)) & 1;
+}
+
+int layout_selectable(const layout_t *layout, const board_t *board, int slot);
+
+#endif
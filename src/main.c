@@ -8,6 +8,11 @@
 
 #include "common.h"
 #include "board.h"
+#include "layout.h"
+#include "session.h"
+#include "pool.h"
+#include "monitor.h"
+#include "storage.h"
 #include "maps.h"
 #include "bitmaps.h"
 #include "geometry.h"
@@ -20,27 +25,35 @@
 #endif
 
 #define SAVED_GAME_PATH (STATEPATH "/pb-mahjong.saved-game")
+#define DEAL_POOL_PATH (STATEPATH "/pb-mahjong.deals")
 #define MAPS_DIR (CONFIGPATH "/pb-mahjong")
 #define MAPS_EXT ".map"
 
 static int orientation = ROTATE270;
-static board_t g_board;
-static int row_count;
-static int col_count;
+static game_session_t *g_session;
+static deal_pool_t *g_pool;
+static monitor_t *g_monitor; /* NULL if it couldn't be started */
 static int caret_pos;
 static int selection_pos = -1;
-static positions_t *g_selectable = NULL;
-static int help_index = 0;
-static int help_offset = 0;
 static int game_active = 0;
 static char **map_list;
 static int map_list_size;
+static int *g_draw_order = NULL; /* Slots in drawing order */
 
 extern const ibitmap background;
 
 #define HELP_HEIGHT (60)
 
+#define DEAL_SLICE 0.1 /* Seconds of searching between two looks at the input */
+#define DEAL_TIMER 10 /* ms */
+#define POOL_SLICE 0.05 /* Seconds spent on the pool per timer tick */
+#define POOL_TIMER 200 /* ms */
+#define MONITOR_TIMER 250 /* ms between looks at the answer */
+#define HINT_SLICE 0.02 /* Seconds spent on ranking hints per timer tick */
+#define HINT_TIMER 50 /* ms */
+
 static int game_handler(int type, int par1, int par2);
+static int deal_handler(int type, int par1, int par2);
 static void menu_handler(int index);
 static void load_map_handler(int index);
 static int main_handler(int type, int par1, int par2);
@@ -48,81 +61,43 @@ static void read_state(void);
 static void write_state(void);
 static int load_game(void);
 static void save_game(void);
+static void read_pool(void);
+static void save_pool(void);
+static void fill_pool(void);
 static void scan_maps(const char *directory);
 static map_t *load_map(const char *name);
+static void build_draw_order(void);
 
-static struct
-{
-	position_t positions[144];
-	chip_t chips[144];
-	int count;
-} undo_stack;
-
-static int cmp_pos(const void *p1, const void *p2)
+static position_t selectable_position(int index)
 {
-	const position_t *pos1 = p1;
-	const position_t *pos2 = p2;
-	return
-		((pos1->y - 1) / 2 * MAX_COL_COUNT + pos1->x) -
-		((pos2->y - 1) / 2 * MAX_COL_COUNT + pos2->x);
+	return layout_position(g_session->board.layout, g_session->board.free.slot[index]);
 }
 
-static void rebuild_selectables(void)
+static chip_t selectable_chip(int index)
 {
-	if(g_selectable != NULL)
-		free(g_selectable);
-
-	g_selectable = get_selectable_positions(&g_board);
-	qsort(&g_selectable->positions[0], g_selectable->count, sizeof(position_t), cmp_pos);
-
-	help_index = 0;
-	help_offset = 0;
+	return board_chip(&g_session->board, g_session->board.free.slot[index]);
 }
 
 static void undo()
 {
-	int i;
-
-	if(undo_stack.count == 0)
+	if(!session_undo(g_session))
 		return;
 
-	for(i = 0; i < 2; ++i) {
-		board_set( &g_board, &undo_stack.positions[undo_stack.count - 1], undo_stack.chips[undo_stack.count - 1]);
-		--undo_stack.count;
-	}
-	g_board.chip_count += 2;
-
 	selection_pos = -1;
-	rebuild_selectables();
 
 	// find caret pos
-	if(caret_pos >= g_selectable->count)
-		caret_pos = g_selectable->count - 1;
-}
-
-static void clear_undo_stack()
-{
-	undo_stack.count = 0;
+	if(caret_pos >= g_session->board.free.count)
+		caret_pos = g_session->board.free.count - 1;
 }
 
 static void start_game(void)
 {
-	rebuild_selectables();
+	build_draw_order();
 	caret_pos = 0;
 	selection_pos = -1;
 	game_active = 1;
 	unlink(SAVED_GAME_PATH);
-}
-
-static void init_map(map_t *map)
-{
-	clear_undo_stack();
-
-	generate_board(&g_board, map);
-	row_count = map->row_count;
-	col_count = map->col_count;
-
-	start_game();
+	fill_pool();
 }
 
 static void cell_rect(const position_t *pos, struct rect *r)
@@ -137,6 +112,8 @@ static void cell_rect(const position_t *pos, struct rect *r)
 
 	const int chip_width = IMG_WIDTH + 10;
 	const int chip_height = IMG_HEIGHT + 10;
+	const int row_count = g_session->row_count;
+	const int col_count = g_session->col_count;
 	if(chip_width * col_count * screen_height > screen_width * chip_height * row_count) {
 		w = screen_width / col_count;
 		h = w * chip_height / chip_width;
@@ -156,6 +133,12 @@ static void cell_rect(const position_t *pos, struct rect *r)
 	r->y = offset_y + pos->y * h + bw * pos->z;
 }
 
+static void selectable_rect(int index, struct rect *r)
+{
+	const position_t pos = selectable_position(index);
+	cell_rect(&pos, r);
+}
+
 static void draw_chip(const position_t *pos, chip_t chip)
 {
 	int i;
@@ -232,9 +215,9 @@ static void draw_chip(const position_t *pos, chip_t chip)
 
 	StretchBitmap(r.x + 5, r.y + 5, r.w - 10, r.h - 10, (ibitmap*)bitmaps[chip], 0);
 
-	if(selection_pos >= 0 && selection_pos < g_selectable->count) {
-		position_t *selection = &g_selectable->positions[selection_pos];
-		if(position_equal(pos, selection))
+	if(selection_pos >= 0 && selection_pos < g_session->board.free.count) {
+		const position_t selection = selectable_position(selection_pos);
+		if(position_equal(pos, &selection))
 			InvertArea(r.x + 1, r.y + 1, r.w - 2, r.h - 2);
 	}
 }
@@ -269,153 +252,167 @@ static ifont *get_help_font(void)
 	return g_help_font;
 }
 
-static void main_repaint(void)
+static int is_slot_covered_by(const void *p1, const void *p2)
 {
-	int i, j, k;
-	position_t *chips = (position_t *) malloc(sizeof(position_t) * g_board.chip_count);
-	int chip_count = 0;
+	const position_t s1 = layout_position(g_session->board.layout, *(const int *) p1);
+	const position_t s2 = layout_position(g_session->board.layout, *(const int *) p2);
+	return is_covered_by(&s1, &s2);
+}
 
-	for(i = 0; i < MAX_ROW_COUNT; ++i) {
-		for(j = 0; j < MAX_COL_COUNT; ++j) {
-			for(k = 0; k < MAX_HEIGHT; ++k) {
-				if(chip_count >= g_board.chip_count)
-					break;
-				const chip_t chip = g_board.columns[i][j].chips[k];
-				if(chip) {
-					chips[chip_count].x = j;
-					chips[chip_count].y = i;
-					chips[chip_count].z = k;
-					++chip_count;
-				}
-			}
-		}
-	}
-	topological_sort(chips, chip_count, sizeof(position_t), is_covered_by);
+/* Sorts all slots of the layout once, any subset of them can be drawn in that order */
+static void build_draw_order(void)
+{
+	int i;
+	const layout_t *layout = g_session->board.layout;
 
-	ClearScreen();
+	free(g_draw_order);
+	g_draw_order = (int *) malloc(sizeof(int) * layout->slot_count);
+	for(i = 0; i < layout->slot_count; ++i)
+		g_draw_order[i] = i;
+	topological_sort(g_draw_order, layout->slot_count, sizeof(int), is_slot_covered_by);
+}
 
-	for(i = chip_count - 1; i >= 0; --i) {
-		const position_t *pos = &chips[i];
-		draw_chip(pos, board_get(&g_board, pos));
-	}
+static void monitor_timer(void);
+static void hint_timer(void);
 
-	/* status bar */
-	{
-		struct rect r;
-		r.x = 0;
-		r.y = ScreenHeight() - HELP_HEIGHT;
-		r.w = ScreenWidth();
-		r.h = HELP_HEIGHT;
+static void status_bar_rect(struct rect *r)
+{
+	r->x = 0;
+	r->y = ScreenHeight() - HELP_HEIGHT;
+	r->w = ScreenWidth();
+	r->h = HELP_HEIGHT;
+}
 
-		DrawLine(r.x, r.y, r.x + r.w, r.y, BLACK);
-		DrawLine(r.x, r.y + 1, r.x + r.w, r.y + 1, LGRAY);
-		FillArea(r.x, r.y + 2, r.w, r.h - 2, DGRAY);
+static void draw_status_bar(void)
+{
+	struct rect r;
+	status_bar_rect(&r);
 
-		SetFont(get_help_font(), WHITE);
+	DrawLine(r.x, r.y, r.x + r.w, r.y, BLACK);
+	DrawLine(r.x, r.y + 1, r.x + r.w, r.y + 1, LGRAY);
+	FillArea(r.x, r.y + 2, r.w, r.h - 2, DGRAY);
 
-		r.x += 10;
-		r.w -= 20;
-		r.y += 8;
-		r.h -= 2;
+	SetFont(get_help_font(), WHITE);
 
-		{
-			int pairs = 0;
-			for(i = 0; i < g_selectable->count - 1; ++i) {
-				const chip_t chip1 = board_get(&g_board, &g_selectable->positions[i]);
-				for(j = i + 1; j < g_selectable->count; ++j) {
-					const chip_t chip2 = board_get(&g_board, &g_selectable->positions[j]);
-					if(fits(chip1, chip2))
-						++pairs;
-				}
-			}
+	r.x += 10;
+	r.w -= 20;
+	r.y += 8;
+	r.h -= 2;
+
+	{
+		char buffer[256];
+		const int len = snprintf(buffer, 256, get_message(MSG_MOVES_LEFT), g_session->board.free_pair_count);
+
+		/* Asking only hands the board over, the answer shows up through the timer */
+		if(g_monitor != NULL && game_active) {
+			static const message_id answer_message[] = { MSG_MONITOR_PENDING, MSG_MONITOR_WINNABLE, MSG_MONITOR_LOST, MSG_MONITOR_UNKNOWN };
+			const monitor_answer_t answer = monitor_ask(g_monitor, &g_session->board);
 
-			char buffer[256];
-			snprintf(buffer, 256, get_message(MSG_MOVES_LEFT), pairs);
-			DrawTextRect(r.x, r.y, r.w, r.h, buffer, ALIGN_FIT | ALIGN_LEFT);
+			snprintf(buffer + len, 256 - len, ", %s", get_message(answer_message[answer]));
+			if(answer == MONITOR_PENDING)
+				SetWeakTimer("monitor", monitor_timer, MONITOR_TIMER);
 		}
+		DrawTextRect(r.x, r.y, r.w, r.h, buffer, ALIGN_FIT | ALIGN_LEFT);
+	}
 
-		DrawTextRect(r.x, r.y, r.w, r.h, (char*)get_message(MSG_HELP), ALIGN_FIT | ALIGN_RIGHT);
+	/* So a deal can be passed on and played again */
+	if(g_session->deal_id.layout_hash) {
+		char id[DEAL_ID_LENGTH + 1];
+		deal_id_format(&g_session->deal_id, id);
+		DrawTextRect(r.x, r.y, r.w, r.h, id, ALIGN_FIT | ALIGN_CENTER);
 	}
+
+	DrawTextRect(r.x, r.y, r.w, r.h, (char*)get_message(MSG_HELP), ALIGN_FIT | ALIGN_RIGHT);
 }
 
-static int finished(void)
+/* Redraws just the status bar, and only while the board is on the screen */
+static void monitor_timer(void)
 {
-	int i, j, k;
+	struct rect r;
 
-	for(i = 0; i < MAX_ROW_COUNT; ++i) {
-		for(j = 0; j < MAX_COL_COUNT; ++j) {
-			for(k = 0; k < MAX_HEIGHT; ++k) {
-				position_t pos;
-				pos.y = i;
-				pos.x = j;
-				pos.z = k;
-				chip_t chip = board_get(&g_board, &pos);
-				if(chip != 0 && (chip & CHIP_CATEGORY_MASK) != CHIP_CATEGORY_BLOCK)
-					return 0;
-			}
-		}
-	}
-	return 1;
+	if(GetEventHandler() != game_handler || !game_active)
+		return;
+	draw_status_bar();
+	status_bar_rect(&r);
+	PartialUpdate(r.x, r.y, r.w, r.h);
 }
 
-static int pair_exists(board_t *board)
+static void main_repaint(void)
 {
-	int i, j;
+	int i;
 
-	for(i = 0; i < g_selectable->count - 1; ++i) {
-		const chip_t chip1 = board_get(board, &g_selectable->positions[i]);
-		for(j = i + 1; j < g_selectable->count; ++j) {
-			const chip_t chip2 = board_get(board, &g_selectable->positions[j]);
-			if(fits(chip1, chip2))
-				return 1;
-		}
+	ClearScreen();
+
+	for(i = g_session->board.layout->slot_count - 1; i >= 0; --i) {
+		const position_t pos = layout_position(g_session->board.layout, g_draw_order[i]);
+		const chip_t chip = board_chip(&g_session->board, g_draw_order[i]);
+		if(chip)
+			draw_chip(&pos, chip);
 	}
-	return 0;
+
+	draw_status_bar();
+
+	/* Every new position is drawn, the hints for it are ranked while the player thinks */
+	if(game_active)
+		SetWeakTimer("hints", hint_timer, HINT_TIMER);
 }
 
 static void select_cell(void)
 {
 	if(selection_pos == caret_pos) {
 		struct rect r;
-		cell_rect(&g_selectable->positions[selection_pos], &r);
+		selectable_rect(selection_pos, &r);
 		selection_pos = -1;
 		main_repaint();
 		PartialUpdate(r.x, r.y, r.w, r.h);
 		return;
 	}
 
-	position_t *position1 = NULL;
 	chip_t chip1 = 0;
 	struct rect r1;
 	if(selection_pos >= 0) {
-		position1 = &g_selectable->positions[selection_pos];
-		chip1 = board_get(&g_board, position1);
-		cell_rect(position1, &r1);
+		chip1 = selectable_chip(selection_pos);
+		selectable_rect(selection_pos, &r1);
 	}
-	position_t *position2 = &g_selectable->positions[caret_pos];
-	chip_t chip2 = board_get(&g_board, position2);
+	chip_t chip2 = selectable_chip(caret_pos);
 	struct rect r2;
-	cell_rect(position2, &r2);
+	selectable_rect(caret_pos, &r2);
 
 	if(chip1 != 0 && fits(chip1, chip2)) {
-		undo_stack.positions[undo_stack.count] = *position1;
-		undo_stack.chips[undo_stack.count] = chip1;
-		++undo_stack.count;
-		undo_stack.positions[undo_stack.count] = *position2;
-		undo_stack.chips[undo_stack.count] = chip2;
-		++undo_stack.count;
-
-		board_set(&g_board, position1, 0);
-		board_set(&g_board, position2, 0);
-		g_board.chip_count -= 2;
+		/* The player is told once, a game that was lost before the move goes on quietly */
+		const int was_lost = session_status(g_session) == SESSION_LOST;
+		session_apply_move(g_session, g_session->board.free.slot[selection_pos], g_session->board.free.slot[caret_pos]);
 
 		selection_pos = -1;
-
-		rebuild_selectables();
 		// find caret pos
-		if(caret_pos >= g_selectable->count)
-			caret_pos = g_selectable->count - 1;
+		if(caret_pos >= g_session->board.free.count)
+			caret_pos = g_session->board.free.count - 1;
 
+		static message_id stuck_menu[] = {
+			MSG_RESHUFFLE,
+			MSG_UNDO,
+			MSG_SEPARATOR,
+			MSG_NEW_GAME_EASY,
+			MSG_NEW_GAME_DIFFICULT,
+			MSG_NEW_GAME_FOUR_BRIDGES,
+			MSG_NEW_GAME_CUSTOM,
+			MSG_SEPARATOR,
+			MSG_EXIT,
+			MSG_NONE
+		};
+		static message_id lost_menu[] = {
+			MSG_CONTINUE,
+			MSG_RESHUFFLE,
+			MSG_UNDO,
+			MSG_SEPARATOR,
+			MSG_NEW_GAME_EASY,
+			MSG_NEW_GAME_DIFFICULT,
+			MSG_NEW_GAME_FOUR_BRIDGES,
+			MSG_NEW_GAME_CUSTOM,
+			MSG_SEPARATOR,
+			MSG_EXIT,
+			MSG_NONE
+		};
 		static message_id finish_menu[] = {
 			MSG_NEW_GAME_EASY,
 			MSG_NEW_GAME_DIFFICULT,
@@ -426,17 +423,18 @@ static void select_cell(void)
 			MSG_NONE
 		};
 
-		if(finished()) {
+		const session_status_t status = session_status(g_session);
+		if(status == SESSION_WON) {
 			game_active = 0;
 			load_map(NULL);
-			clear_undo_stack();
 			show_popup(&background, MSG_WIN, finish_menu, menu_handler);
 		}
-		else if(!pair_exists(&g_board)) {
-			game_active = 0;
-			load_map(NULL);
-			clear_undo_stack();
-			show_popup(&background, MSG_LOSE, finish_menu, menu_handler);
+		else if(status == SESSION_STUCK) {
+			/* The game goes on if the player reshuffles or takes a move back */
+			show_popup(&background, MSG_LOSE, stuck_menu, menu_handler);
+		}
+		else if(status == SESSION_LOST && !was_lost) {
+			show_popup(&background, MSG_DEADLOCK, lost_menu, menu_handler);
 		}
 		else {
 			main_repaint();
@@ -464,32 +462,22 @@ static void select_cell(void)
 	}
 }
 
-static void make_hint()
+/* Ranks the hints in slices, so a tap in between is handled right away */
+static void hint_timer(void)
 {
-	int i, j;
+	if(game_active && session_prepare_hints(g_session, HINT_SLICE))
+		SetWeakTimer("hints", hint_timer, HINT_TIMER);
+}
 
-	for(;;) {
-		for(i = help_index; i < g_selectable->count - 1; ++i) {
-			const chip_t chip1 = board_get(&g_board, &g_selectable->positions[i]);
+static void make_hint()
+{
+	move_t move;
 
-			for(j = i + 1 + help_offset; j < g_selectable->count; ++j) {
-				const chip_t chip2 = board_get(&g_board, &g_selectable->positions[j]);
+	if(!session_hint(g_session, &move))
+		return; /* Should never be reached, the game ends without moves */
 
-				if(fits(chip1, chip2)) {
-					help_index = i;
-					help_offset = j - i - 1 + 1;
-					selection_pos = i;
-					caret_pos = j;
-					return;
-				}
-			}
-			help_offset = 0;
-		}
-		if(help_index == 0)
-			return; /*Should never be reached, but this avoids an endless loop in that case */
-		help_index = 0;
-		help_offset = 0;
-	}
+	selection_pos = free_set_index(&g_session->board.free, move.slot1);
+	caret_pos = free_set_index(&g_session->board.free, move.slot2);
 }
 
 static int game_handler(int type, int par1, int par2)
@@ -530,7 +518,7 @@ static int game_handler(int type, int par1, int par2)
 						MSG_EXIT,
 						MSG_NONE
 					};
-					if(undo_stack.count != 0)
+					if(g_session->undo_count != 0)
 						show_popup(NULL, MSG_NONE, game_menu_with_undo, menu_handler);
 					else
 						show_popup(NULL, MSG_NONE, game_menu, menu_handler);
@@ -556,9 +544,9 @@ static int game_handler(int type, int par1, int par2)
 
 			point_change_orientation(par1, par2, GetOrientation(), &rx, &ry);
 
-			for(i = 0; i < g_selectable->count; ++i) {
+			for(i = 0; i < g_session->board.free.count; ++i) {
 				struct rect r;
-				cell_rect(&g_selectable->positions[i], &r);
+				selectable_rect(i, &r);
 				if(point_in_rect(rx, ry, &r)) {
 					int prev_caret_pos = caret_pos;
 					struct rect prev_r;
@@ -566,7 +554,7 @@ static int game_handler(int type, int par1, int par2)
 					caret_pos = i;
 
 					main_repaint();
-					cell_rect(&g_selectable->positions[prev_caret_pos], &prev_r);
+					selectable_rect(prev_caret_pos, &prev_r);
 					PartialUpdate(prev_r.x, prev_r.y, prev_r.w, prev_r.h);
 
 					select_cell();
@@ -585,6 +573,7 @@ static message_id main_menu_wo_load[] = {
 	MSG_NEW_GAME_FOUR_BRIDGES,
 	MSG_NEW_GAME_CUSTOM,
 	MSG_SEPARATOR,
+	MSG_DIFFICULTY_NORMAL, /* See show_difficulty() */
 	MSG_TOGGLE_LANGUAGE,
 	MSG_CHANGE_ORIENTATION,
 	MSG_SEPARATOR,
@@ -600,6 +589,7 @@ static message_id main_menu_w_load[] = {
 	MSG_SEPARATOR,
 	MSG_LOAD,
 	MSG_SEPARATOR,
+	MSG_DIFFICULTY_NORMAL, /* See show_difficulty() */
 	MSG_TOGGLE_LANGUAGE,
 	MSG_CHANGE_ORIENTATION,
 	MSG_SEPARATOR,
@@ -609,6 +599,126 @@ static message_id main_menu_w_load[] = {
 
 static message_id *main_menu;
 
+static const message_id difficulty_entry[DIFFICULTY_COUNT] = {
+	MSG_DIFFICULTY_NORMAL,
+	MSG_DIFFICULTY_EASY,
+	MSG_DIFFICULTY_HARD
+};
+
+/* The main menus name the difficulty of new deals */
+static void show_difficulty(void)
+{
+	message_id *menus[] = { main_menu_wo_load, main_menu_w_load };
+	unsigned int i;
+	int k;
+
+	for(i = 0; i < sizeof(menus) / sizeof(menus[0]); ++i)
+		for(k = 0; menus[i][k] != MSG_NONE; ++k)
+			if(menus[i][k] == MSG_DIFFICULTY_NORMAL || menus[i][k] == MSG_DIFFICULTY_EASY || menus[i][k] == MSG_DIFFICULTY_HARD)
+				menus[i][k] = difficulty_entry[g_session->difficulty];
+}
+
+static int g_dealing_custom; /* Whether the map being dealt came from the list */
+
+static void deal_failed(void)
+{
+	if(g_dealing_custom)
+		show_popup_list(&background, MSG_DEAL_FAILED, map_list, load_map_handler);
+	else
+		show_popup(&background, MSG_DEAL_FAILED, main_menu, menu_handler);
+}
+
+static void draw_deal_progress(void)
+{
+	char buffer[256];
+	const int w = ScreenWidth() / 2;
+	const int h = HELP_HEIGHT;
+	const int x = (ScreenWidth() - w) / 2;
+	const int y = (ScreenHeight() - h) / 2;
+
+	FillArea(x, y, w, h, WHITE);
+	DrawRect(x, y, w, h, BLACK);
+	SetFont(get_help_font(), BLACK);
+	snprintf(buffer, 256, get_message(MSG_DEALING), (int) (session_deal_progress(g_session) * 100));
+	DrawTextRect(x, y, w, h, buffer, ALIGN_CENTER | VALIGN_MIDDLE);
+	PartialUpdate(x, y, w, h);
+}
+
+/* Searches a little at a time, so the device keeps reacting to the keys */
+static void deal_timer(void)
+{
+	const int result = session_continue_deal(g_session, DEAL_SLICE);
+
+	if(result == GENERATOR_RUNNING) {
+		draw_deal_progress();
+		SetHardTimer("deal", deal_timer, DEAL_TIMER);
+	}
+	else if(result) {
+		start_game();
+		SetEventHandler(game_handler);
+	}
+	else {
+		deal_failed();
+	}
+}
+
+static void init_map(map_t *map, int custom)
+{
+	board_t deal;
+	uint32_t seed;
+
+	game_active = 0;
+	g_dealing_custom = custom;
+
+	/* Custom maps are only known to the pool once played, it only holds normal deals */
+	deal_pool_add_map(g_pool, map);
+	if(g_session->difficulty == DIFFICULTY_NORMAL && deal_pool_take(g_pool, map, &deal, &seed)) {
+		session_use_deal(g_session, map, &deal, seed);
+		start_game();
+		SetEventHandler(game_handler);
+		return;
+	}
+
+	/* With more than one core the threads are usually done before anyone notices */
+	if(g_session->generator_threads > 1) {
+		if(session_new_game(g_session, map)) {
+			start_game();
+			SetEventHandler(game_handler);
+		}
+		else {
+			deal_failed();
+		}
+		return;
+	}
+
+	if(!session_start_deal(g_session, map)) {
+		deal_failed();
+		return;
+	}
+	SetEventHandler(deal_handler);
+	SetHardTimer("deal", deal_timer, 0);
+}
+
+static int deal_handler(int type, int par1, int par2)
+{
+	switch(type) {
+		case EVT_SHOW:
+			ClearScreen();
+			StretchBitmap(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, (ibitmap*)&background, 0);
+			FullUpdate();
+			draw_deal_progress();
+			break;
+
+		case EVT_KEYPRESS:
+			/* Any key gives up on the deal */
+			ClearTimer(deal_timer);
+			session_cancel_deal(g_session);
+			show_popup(&background, MSG_NONE, main_menu, menu_handler);
+			return 1;
+	}
+	return 0;
+}
+
 static void menu_handler(int index)
 {
 	switch(index)
@@ -622,24 +732,32 @@ static void menu_handler(int index)
 			SetEventHandler(game_handler);
 			break;
 
+		case MSG_RESHUFFLE:
+			if(session_reshuffle(g_session)) {
+				caret_pos = 0;
+				selection_pos = -1;
+				SetEventHandler(game_handler);
+			}
+			else {
+				show_popup(&background, MSG_DEAL_FAILED, main_menu, menu_handler);
+			}
+			break;
+
 		case MSG_UNDO:
 			undo();
 			SetEventHandler(game_handler);
 			break;
 
 		case MSG_NEW_GAME_EASY:
-			init_map(&standard_map);
-			SetEventHandler(game_handler);
+			init_map(&standard_map, 0);
 			break;
 
 		case MSG_NEW_GAME_DIFFICULT:
-			init_map(&difficult_map);
-			SetEventHandler(game_handler);
+			init_map(&difficult_map, 0);
 			break;
 
 		case MSG_NEW_GAME_FOUR_BRIDGES:
-			init_map(&four_bridges_map);
-			SetEventHandler(game_handler);
+			init_map(&four_bridges_map, 0);
 			break;
 
 		case MSG_NEW_GAME_CUSTOM:
@@ -652,6 +770,18 @@ static void menu_handler(int index)
 				start_game();
 				SetEventHandler(game_handler);
 			}
+			else {
+				/* A damaged saved game, the session may be left without a board */
+				init_map(&standard_map, 0);
+			}
+			break;
+
+		case MSG_DIFFICULTY_NORMAL:
+		case MSG_DIFFICULTY_EASY:
+		case MSG_DIFFICULTY_HARD:
+			g_session->difficulty = (g_session->difficulty + 1) % DIFFICULTY_COUNT;
+			show_difficulty();
+			show_popup(&background, MSG_NONE, main_menu, menu_handler);
 			break;
 
 		case MSG_TOGGLE_LANGUAGE:
@@ -680,6 +810,7 @@ static void menu_handler(int index)
 			write_state();
 			if(game_active)
 				save_game();
+			save_pool();
 			CloseApp();
 			break;
 	}
@@ -689,13 +820,10 @@ static void load_map_handler(int index)
 {
 	if(index >= 0 && index <= map_list_size) {
 		map_t *map = load_map(map_list[index]);
-		if(map != NULL) {
-			init_map(map);
-			SetEventHandler(game_handler);
-		}
-		else {
+		if(map == NULL)
 			show_popup_list(&background, MSG_LOADING_FAILED, map_list, load_map_handler);
-		}
+		else
+			init_map(map, 1);
 	}
 	else {
 		show_popup(&background, MSG_NONE, main_menu, menu_handler);
@@ -707,9 +835,13 @@ static int main_handler(int type, int par1, int par2)
 	switch(type) {
 		case EVT_INIT:
 			SetPanelType(PANEL_DISABLED);
-			srand(time(NULL));
+			rrand_seed(time(NULL));
+			g_session = session_create();
+			session_seed(g_session, rrand_u32());
+			g_session->generator_threads = sysconf(_SC_NPROCESSORS_ONLN);
 			bitmaps_init();
 			read_state();
+			show_difficulty();
 			SetOrientation(orientation);
 			if(!access(SAVED_GAME_PATH, R_OK))
 				main_menu = main_menu_w_load;
@@ -717,12 +849,22 @@ static int main_handler(int type, int par1, int par2)
 				main_menu = main_menu_wo_load;
 			scan_maps(MAPS_DIR);
 
+			g_monitor = monitor_create();
+
+			g_pool = deal_pool_create(rrand_u32());
+			deal_pool_add_map(g_pool, &standard_map);
+			deal_pool_add_map(g_pool, &difficult_map);
+			deal_pool_add_map(g_pool, &four_bridges_map);
+			read_pool();
+
 			show_popup(&background, MSG_NONE, main_menu, menu_handler);
+			fill_pool();
 			break;
 
 		case EVT_EXIT:
 			if(game_active)
 				save_game();
+			save_pool();
 			break;
 	}
 	return 0;
@@ -758,6 +900,14 @@ static void read_state(void)
 			else if(!strcmp(value, "de"))
 				current_language = GERMAN;
 		}
+		else if(!strcmp(key, "difficulty")) {
+			if(!strcmp(value, "normal"))
+				g_session->difficulty = DIFFICULTY_NORMAL;
+			else if(!strcmp(value, "easy"))
+				g_session->difficulty = DIFFICULTY_EASY;
+			else if(!strcmp(value, "hard"))
+				g_session->difficulty = DIFFICULTY_HARD;
+		}
 		else if(!strcmp(key, "orientation")) {
 			if(!strcmp(value, "90"))
 				orientation = ROTATE90;
@@ -783,6 +933,13 @@ static void write_state(void)
 	else if(current_language == GERMAN)
 		fprintf(f, "language = de\n");
 
+	if(g_session->difficulty == DIFFICULTY_EASY)
+		fprintf(f, "difficulty = easy\n");
+	else if(g_session->difficulty == DIFFICULTY_HARD)
+		fprintf(f, "difficulty = hard\n");
+	else
+		fprintf(f, "difficulty = normal\n");
+
 	if(orientation == ROTATE90)
 		fprintf(f, "orientation = 90\n");
 	else if(orientation == ROTATE270)
@@ -793,90 +950,61 @@ static void write_state(void)
 
 static int load_game(void)
 {
-	int i, j, k;
-
 	FILE *f = fopen(SAVED_GAME_PATH, "r");
 	if(!f)
 		return 0;
 
-	fscanf(f, "%d %d\n", &row_count, &col_count);
-
-	for(i = 0; i < MAX_ROW_COUNT; ++i) {
-		for(j = 0; j < MAX_COL_COUNT; ++j) {
-			for(k = 0; k < MAX_HEIGHT; ++k) {
-				int chip;
-				position_t pos;
-				pos.y = i;
-				pos.x = j;
-				pos.z = k;
-
-				fscanf(f, "%d\n", &chip);
-
-				board_set(&g_board, &pos, chip);
-				if(chip)
-					++g_board.chip_count;
-			}
-		}
-	}
-
-	fscanf(f, "%d\n", &undo_stack.count);
-	for(i = 0; i < undo_stack.count; ++i) {
-		int chip, x, y, z;
-		fscanf(
-			f, "%d %d %d %d\n",
-			&y,
-			&x,
-			&z,
-			&chip);
-		undo_stack.positions[i].y = (unsigned char) y;
-		undo_stack.positions[i].x = (unsigned char) x;
-		undo_stack.positions[i].z = (unsigned char) z;
-		undo_stack.chips[i] = (chip_t) chip;
-	}
-
+	/* Restoring frees the layout of the last restored game */
+	monitor_forget(g_monitor);
+	const int result = session_read(g_session, f);
 	fclose(f);
-
-	return 1;
+	return result;
 }
 
 static void save_game(void)
 {
-	int i, j, k;
-
 	FILE *f = fopen(SAVED_GAME_PATH, "w");
 	if(!f)
 		return;
 
-	fprintf(f, "%d %d\n", row_count, col_count);
+	session_write(g_session, f);
+	fclose(f);
+}
 
-	for(i = 0; i < MAX_ROW_COUNT; ++i) {
-		for(j = 0; j < MAX_COL_COUNT; ++j) {
-			for(k = 0; k < MAX_HEIGHT; ++k) {
-				chip_t ch;
-				position_t pos;
-				pos.y = i;
-				pos.x = j;
-				pos.z = k;
-				ch = board_get(&g_board, &pos);
+static void read_pool(void)
+{
+	FILE *f = fopen(DEAL_POOL_PATH, "r");
+	if(!f)
+		return;
 
-				fprintf(f, "%d\n", ch);
-			}
-		}
-	}
+	deal_pool_read(g_pool, f);
+	fclose(f);
+}
 
-	fprintf(f, "%d\n", undo_stack.count);
-	for(i = 0; i < undo_stack.count; ++i) {
-		fprintf(
-			f, "%d %d %d %d\n",
-			undo_stack.positions[i].y,
-			undo_stack.positions[i].x,
-			undo_stack.positions[i].z,
-			undo_stack.chips[i]);
-	}
+static void save_pool(void)
+{
+	FILE *f = fopen(DEAL_POOL_PATH, "w");
+	if(!f)
+		return;
 
+	deal_pool_write(g_pool, f);
 	fclose(f);
 }
 
+static void pool_timer(void)
+{
+	if(deal_pool_fill(g_pool, POOL_SLICE))
+		SetWeakTimer("pool", pool_timer, POOL_TIMER);
+}
+
+/* Tops up the pool on a thread when there are cores to spare, from a timer otherwise */
+static void fill_pool(void)
+{
+	if(g_session->generator_threads > 1 && deal_pool_start(g_pool))
+		return;
+	SetWeakTimer("pool", pool_timer, POOL_TIMER);
+}
+
 static int is_map(const struct dirent *file)
 {
 	int len = strlen(file->d_name) - strlen(MAPS_EXT);
@@ -912,15 +1040,11 @@ static map_t *load_map(const char *name)
 {
 	static map_t *loaded_map;
 	static char *loaded_name;
+	map_t map;
 
-	if(loaded_name != NULL) {
-		free(loaded_name);
-		loaded_name = NULL;
-	}
+	/* Read the new map first, the old one stays in play if it can't be used */
 	if(name != NULL) {
-		if(loaded_map == NULL)
-			loaded_map = (map_t *) malloc(sizeof(map_t));
-		memset(loaded_map, 0, sizeof(map_t));
+		memset(&map, 0, sizeof(map_t));
 
 		char path[256];
 		sprintf(path, "%s/%s.map", MAPS_DIR, name);
@@ -928,71 +1052,34 @@ static map_t *load_map(const char *name)
 		if(!f)
 			return NULL;
 
-		/* Board size */
-		int col_count = 32;
-		int row_count = 18;
-		if(
-			fscanf(f, "%d %d\n", &col_count, &row_count) == EOF ||
-			col_count < 0 || col_count >= MAX_COL_COUNT ||
-			row_count < 0 || row_count >= MAX_ROW_COUNT)
+		const int result = map_read(&map, f);
+		fclose(f);
+		if(!result || map_layout(&map) == NULL) {
+			map_free(&map);
 			return NULL;
-		loaded_map->col_count = (unsigned char) col_count;
-		loaded_map->row_count = (unsigned char) row_count;
-
-		/* Chip positions */
-		unsigned int chip;
-		int x = 0, y = 0, z = 0;
-		for(chip = 0; chip < CHIP_COUNT; ++chip) {
-			if(
-				fscanf(f, "%d %d %d\n", &x, &y, &z) == EOF ||
-				x < 0 || x >= col_count ||
-				y < 0 || y >= row_count ||
-				z < 0 || z >= MAX_HEIGHT)
-				return NULL;
-
-			loaded_map->chip[chip].x = (unsigned char) x;
-			loaded_map->chip[chip].y = (unsigned char) y;
-			loaded_map->chip[chip].z = (unsigned char) z;
-			x = 0;
-			y = 0;
-			z = 0;
-		}
-
-		/* All following positions are blocker positions */
-		while(fscanf(f, "%d %d %d\n", &x, &y, &z) != EOF) {
-			if(
-				x < 0 || x >= col_count ||
-				y < 0 || y >= row_count ||
-				z < 0 || z >= MAX_HEIGHT)
-				return NULL;
-
-			const unsigned int block = loaded_map->block_count;
-			++loaded_map->block_count;
-			if(loaded_map->block == NULL)
-				loaded_map->block = (position_t *) malloc(sizeof(position_t));
-			else
-				loaded_map->block = (position_t *) realloc(loaded_map->block, sizeof(position_t) * loaded_map->block_count);
-
-			loaded_map->block[block].x = (unsigned char) x;
-			loaded_map->block[block].y = (unsigned char) y;
-			loaded_map->block[block].z = (unsigned char) z;
-			x = 0;
-			y = 0;
-			z = 0;
 		}
+	}
 
-		fclose(f);
+	if(loaded_map != NULL) {
+		/* The game and the monitor may still be looking at a board on it */
+		game_active = 0;
+		monitor_forget(g_monitor);
+		map_free(loaded_map);
+		free(loaded_map);
+		loaded_map = NULL;
+	}
+	if(loaded_name != NULL) {
+		free(loaded_name);
+		loaded_name = NULL;
+	}
 
+	if(name != NULL) {
+		loaded_map = (map_t *) malloc(sizeof(map_t));
+		*loaded_map = map;
 		loaded_name = (char *) malloc(strlen(name) + 1);
 		strcpy(loaded_name, name);
 		loaded_map->name = loaded_name;
 	}
-	else {
-		if(loaded_map != NULL) {
-			free(loaded_map);
-			loaded_map = NULL;
-		}
-	}
 
 	return loaded_map;
 }
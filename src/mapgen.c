@@ -0,0 +1,218 @@
+#include <string.h>
+#include "mapgen.h"
+#include "common.h"
+#include "layout.h"
+#include "storage.h"
+
+void mapgen_default_options(mapgen_options_t *options, int chip_count)
+{
+	options->chip_count = chip_count;
+	if(chip_count <= PILE_STEP) {
+		options->col_count = 24;
+		options->row_count = 14;
+	}
+	else if(chip_count <= CHIP_COUNT) {
+		options->col_count = 32;
+		options->row_count = 18;
+	}
+	else {
+		options->col_count = 38;
+		options->row_count = 22;
+	}
+	options->max_height = 5;
+	options->mirror_rows = 1;
+}
+
+typedef struct {
+	const mapgen_options_t *options;
+	rng_t rng;
+	unsigned char cover[MAX_HEIGHT][MAX_ROW_COUNT][MAX_COL_COUNT]; /* Half tile cells taken per level */
+	position_t tile[MAX_CHIP_COUNT];
+	int count;
+	int stack_chance; /* Percent of the steps going up a level, differs per layout */
+	int shift_chance; /* Percent of the steps going half a tile aside */
+} builder_t;
+
+/* Inside the margin, on free cells and resting on the level below everywhere */
+static int fits_at(const builder_t *b, int x, int y, int z)
+{
+	int i, j;
+	const mapgen_options_t *options = b->options;
+
+	if(x < 1 || y < 1 || x + 1 > options->col_count - 2 || y + 1 > options->row_count - 2)
+		return 0;
+	if(z < 0 || z >= options->max_height)
+		return 0;
+
+	for(i = 0; i < 2; ++i) {
+		for(j = 0; j < 2; ++j) {
+			if(b->cover[z][y + i][x + j])
+				return 0;
+			if(z > 0 && !b->cover[z - 1][y + i][x + j])
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static int overlaps(const position_t *a, const position_t *b)
+{
+	return a->z == b->z && abs(a->x - b->x) < 2 && abs(a->y - b->y) < 2;
+}
+
+/* The tile and its mirror images, returns how many different ones there are */
+static int mirror(const builder_t *b, int x, int y, int z, position_t *pos)
+{
+	int i, k;
+	int count = 0;
+	const int mx = b->options->col_count - 2 - x;
+	const int my = b->options->row_count - 2 - y;
+	const int xs[4] = { x, mx, x, mx };
+	const int ys[4] = { y, y, my, my };
+
+	for(i = 0; i < (b->options->mirror_rows ? 4 : 2); ++i) {
+		for(k = 0; k < count; ++k)
+			if(pos[k].x == xs[i] && pos[k].y == ys[i])
+				break;
+		if(k < count)
+			continue;
+		pos[count].x = xs[i];
+		pos[count].y = ys[i];
+		pos[count].z = z;
+		++count;
+	}
+	return count;
+}
+
+/* Places the tile with its mirror images if they all fit, returns 0 otherwise */
+static int try_place(builder_t *b, int x, int y, int z)
+{
+	int i, j, k;
+	position_t pos[4];
+	const int count = mirror(b, x, y, z, pos);
+
+	if(count > b->options->chip_count - b->count)
+		return 0;
+	for(i = 0; i < count; ++i) {
+		if(!fits_at(b, pos[i].x, pos[i].y, z))
+			return 0;
+		for(j = 0; j < i; ++j)
+			if(overlaps(&pos[i], &pos[j]))
+				return 0;
+	}
+
+	for(i = 0; i < count; ++i) {
+		for(j = 0; j < 2; ++j)
+			for(k = 0; k < 2; ++k)
+				b->cover[z][pos[i].y + j][pos[i].x + k] = 1;
+		b->tile[b->count++] = pos[i];
+	}
+	return 1;
+}
+
+/* Grows a layout from the middle, returns 0 if it ran out of room */
+static int build(builder_t *b)
+{
+	long tries;
+	const mapgen_options_t *options = b->options;
+	const long max_tries = 200L * options->chip_count;
+
+	memset(b->cover, 0, sizeof(b->cover));
+	b->count = 0;
+	b->stack_chance = 15 + rng_range(&b->rng, 30);
+	b->shift_chance = rng_range(&b->rng, 20);
+
+	/* Somewhere around the middle to start with */
+	if(!try_place(b, (options->col_count - 2) / 2 - rng_range(&b->rng, 4), (options->row_count - 2) / 2 - rng_range(&b->rng, 4), 0))
+		return 0;
+
+	for(tries = 0; b->count < options->chip_count && tries < max_tries; ++tries) {
+		const position_t *t = &b->tile[rng_range(&b->rng, b->count)];
+		const int shift = rng_range(&b->rng, 100) < b->shift_chance ? 2 * rng_range(&b->rng, 2) - 1 : 0;
+		int x = t->x;
+		int y = t->y;
+		int z = t->z;
+
+		if(rng_range(&b->rng, 100) < b->stack_chance) {
+			/* On top, maybe across two tiles */
+			++z;
+			if(rng_range(&b->rng, 2))
+				x += shift;
+			else
+				y += shift;
+		}
+		else {
+			/* Next to it, maybe half a tile up or down */
+			const int side = 2 * (2 * rng_range(&b->rng, 2) - 1);
+			if(rng_range(&b->rng, 2)) {
+				x += side;
+				y += shift;
+			}
+			else {
+				y += side;
+				x += shift;
+			}
+		}
+		try_place(b, x, y, z);
+	}
+	return b->count == options->chip_count;
+}
+
+static int valid_options(const mapgen_options_t *options)
+{
+	return options->chip_count > 0 && options->chip_count % PILE_STEP == 0 && options->chip_count <= MAX_CHIP_COUNT
+		&& options->col_count >= 4 && options->col_count < MAX_COL_COUNT
+		&& options->row_count >= 4 && options->row_count < MAX_ROW_COUNT
+		&& options->max_height >= 1 && options->max_height <= MAX_HEIGHT;
+}
+
+int generate_map(map_t *map, uint32_t seed, const mapgen_options_t *options, mapgen_stats_t *stats)
+{
+	int attempt;
+	int result = 0;
+	mapgen_stats_t own;
+	builder_t *b;
+	board_t *board;
+	generator_limits_t limits = generator_default_limits;
+
+	if(stats == NULL)
+		stats = &own;
+	memset(stats, 0, sizeof(mapgen_stats_t));
+	memset(map, 0, sizeof(map_t));
+	if(!valid_options(options))
+		return 0;
+
+	b = (builder_t *) malloc(sizeof(builder_t));
+	board = (board_t *) malloc(sizeof(board_t));
+	b->options = options;
+	rng_seed(&b->rng, seed);
+	/* The clock would make the same seed give different maps on slower machines */
+	limits.time_limit = 0;
+
+	for(attempt = 0; attempt < MAPGEN_ATTEMPTS && !result; ++attempt) {
+		++stats->attempts;
+		if(!build(b)) {
+			++stats->stuck;
+			continue;
+		}
+
+		map->col_count = options->col_count;
+		map->row_count = options->row_count;
+		map->chip_count = b->count;
+		map->chip = (position_t *) malloc(sizeof(position_t) * b->count);
+		memcpy(map->chip, b->tile, sizeof(position_t) * b->count);
+
+		/* Only layouts that can be dealt are of any use */
+		if(map_layout(map) != NULL && generate_board(board, map, rng_next(&b->rng), DIFFICULTY_NORMAL, &limits, NULL)) {
+			result = 1;
+		}
+		else {
+			++stats->not_dealable;
+			map_free(map);
+		}
+	}
+
+	free(b);
+	free(board);
+	return result;
+}
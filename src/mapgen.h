@@ -0,0 +1,39 @@
+#ifndef MAPGEN_H
+#define MAPGEN_H
+
+#include "board.h"
+
+/*
+	Procedural layouts. Tiles are added in groups that are mirror images of
+	each other, next to or on top of the tiles placed so far. A tile on a
+	higher level always rests fully on tiles of the level below, and every
+	layout that comes out can be dealt.
+*/
+typedef struct {
+	int chip_count; /* A multiple of PILE_STEP */
+	int col_count; /* Board size in half tiles, the layout keeps a margin of one */
+	int row_count;
+	int max_height; /* Levels */
+	int mirror_rows; /* Symmetric from top to bottom as well as from left to right */
+} mapgen_options_t;
+
+/* A board size fitting the number of chips */
+void mapgen_default_options(mapgen_options_t *options, int chip_count);
+
+typedef struct {
+	int attempts; /* Layouts started, including the one returned */
+	int stuck; /* Attempts that ran out of room before placing all tiles */
+	int not_dealable; /* Attempts whose layout could not be dealt */
+} mapgen_stats_t;
+
+#define MAPGEN_ATTEMPTS 100
+
+/*
+	Makes a new layout from the seed, the same seed and options give the
+	same layout. Returns 0 if none came out within MAPGEN_ATTEMPTS or the
+	options can't work. The map's positions are left for map_free(), its
+	name is NULL and stats may be NULL.
+*/
+int generate_map(map_t *map, uint32_t seed, const mapgen_options_t *options, mapgen_stats_t *stats);
+
+#endif
@@ -1,453 +1,463 @@
 #include "maps.h"
 
+static position_t standard_chips[CHIP_COUNT] = {
+	{14, 8, 4},
+	{13, 9, 3},
+	{15, 9, 3},
+	{13, 7, 3},
+	{15, 7, 3},
+	{11, 11, 2},
+	{13, 11, 2},
+	{15, 11, 2},
+	{17, 11, 2},
+	{11, 9, 2},
+	{13, 9, 2},
+	{15, 9, 2},
+	{17, 9, 2},
+	{11, 7, 2},
+	{13, 7, 2},
+	{15, 7, 2},
+	{17, 7, 2},
+	{11, 5, 2},
+	{13, 5, 2},
+	{15, 5, 2},
+	{17, 5, 2},
+	{9, 13, 1},
+	{11, 13, 1},
+	{13, 13, 1},
+	{15, 13, 1},
+	{17, 13, 1},
+	{19, 13, 1},
+	{9, 11, 1},
+	{11, 11, 1},
+	{13, 11, 1},
+	{15, 11, 1},
+	{17, 11, 1},
+	{19, 11, 1},
+	{9, 9, 1},
+	{11, 9, 1},
+	{13, 9, 1},
+	{15, 9, 1},
+	{17, 9, 1},
+	{19, 9, 1},
+	{9, 7, 1},
+	{11, 7, 1},
+	{13, 7, 1},
+	{15, 7, 1},
+	{17, 7, 1},
+	{19, 7, 1},
+	{9, 5, 1},
+	{11, 5, 1},
+	{13, 5, 1},
+	{15, 5, 1},
+	{17, 5, 1},
+	{19, 5, 1},
+	{9, 3, 1},
+	{11, 3, 1},
+	{13, 3, 1},
+	{15, 3, 1},
+	{17, 3, 1},
+	{19, 3, 1},
+	{3, 15, 0},
+	{5, 15, 0},
+	{7, 15, 0},
+	{9, 15, 0},
+	{11, 15, 0},
+	{13, 15, 0},
+	{15, 15, 0},
+	{17, 15, 0},
+	{19, 15, 0},
+	{21, 15, 0},
+	{23, 15, 0},
+	{25, 15, 0},
+	{7, 13, 0},
+	{9, 13, 0},
+	{11, 13, 0},
+	{13, 13, 0},
+	{15, 13, 0},
+	{17, 13, 0},
+	{19, 13, 0},
+	{21, 13, 0},
+	{5, 11, 0},
+	{7, 11, 0},
+	{9, 11, 0},
+	{11, 11, 0},
+	{13, 11, 0},
+	{15, 11, 0},
+	{17, 11, 0},
+	{19, 11, 0},
+	{21, 11, 0},
+	{23, 11, 0},
+	{1, 8, 0},
+	{3, 9, 0},
+	{5, 9, 0},
+	{7, 9, 0},
+	{9, 9, 0},
+	{11, 9, 0},
+	{13, 9, 0},
+	{15, 9, 0},
+	{17, 9, 0},
+	{19, 9, 0},
+	{21, 9, 0},
+	{23, 9, 0},
+	{25, 9, 0},
+	{3, 7, 0},
+	{5, 7, 0},
+	{7, 7, 0},
+	{9, 7, 0},
+	{11, 7, 0},
+	{13, 7, 0},
+	{15, 7, 0},
+	{17, 7, 0},
+	{19, 7, 0},
+	{21, 7, 0},
+	{23, 7, 0},
+	{25, 7, 0},
+	{5, 5, 0},
+	{7, 5, 0},
+	{9, 5, 0},
+	{11, 5, 0},
+	{13, 5, 0},
+	{15, 5, 0},
+	{17, 5, 0},
+	{19, 5, 0},
+	{21, 5, 0},
+	{23, 5, 0},
+	{7, 3, 0},
+	{9, 3, 0},
+	{11, 3, 0},
+	{13, 3, 0},
+	{15, 3, 0},
+	{17, 3, 0},
+	{19, 3, 0},
+	{21, 3, 0},
+	{3, 1, 0},
+	{5, 1, 0},
+	{7, 1, 0},
+	{9, 1, 0},
+	{11, 1, 0},
+	{13, 1, 0},
+	{15, 1, 0},
+	{17, 1, 0},
+	{19, 1, 0},
+	{21, 1, 0},
+	{23, 1, 0},
+	{25, 1, 0},
+	{27, 8, 0},
+	{29, 8, 0},
+};
+
 map_t standard_map = {
 	"Standard",
 	18, 32,
-	{
-		{14, 8, 4},
-		{13, 9, 3},
-		{15, 9, 3},
-		{13, 7, 3},
-		{15, 7, 3},
-		{11, 11, 2},
-		{13, 11, 2},
-		{15, 11, 2},
-		{17, 11, 2},
-		{11, 9, 2},
-		{13, 9, 2},
-		{15, 9, 2},
-		{17, 9, 2},
-		{11, 7, 2},
-		{13, 7, 2},
-		{15, 7, 2},
-		{17, 7, 2},
-		{11, 5, 2},
-		{13, 5, 2},
-		{15, 5, 2},
-		{17, 5, 2},
-		{9, 13, 1},
-		{11, 13, 1},
-		{13, 13, 1},
-		{15, 13, 1},
-		{17, 13, 1},
-		{19, 13, 1},
-		{9, 11, 1},
-		{11, 11, 1},
-		{13, 11, 1},
-		{15, 11, 1},
-		{17, 11, 1},
-		{19, 11, 1},
-		{9, 9, 1},
-		{11, 9, 1},
-		{13, 9, 1},
-		{15, 9, 1},
-		{17, 9, 1},
-		{19, 9, 1},
-		{9, 7, 1},
-		{11, 7, 1},
-		{13, 7, 1},
-		{15, 7, 1},
-		{17, 7, 1},
-		{19, 7, 1},
-		{9, 5, 1},
-		{11, 5, 1},
-		{13, 5, 1},
-		{15, 5, 1},
-		{17, 5, 1},
-		{19, 5, 1},
-		{9, 3, 1},
-		{11, 3, 1},
-		{13, 3, 1},
-		{15, 3, 1},
-		{17, 3, 1},
-		{19, 3, 1},
-		{3, 15, 0},
-		{5, 15, 0},
-		{7, 15, 0},
-		{9, 15, 0},
-		{11, 15, 0},
-		{13, 15, 0},
-		{15, 15, 0},
-		{17, 15, 0},
-		{19, 15, 0},
-		{21, 15, 0},
-		{23, 15, 0},
-		{25, 15, 0},
-		{7, 13, 0},
-		{9, 13, 0},
-		{11, 13, 0},
-		{13, 13, 0},
-		{15, 13, 0},
-		{17, 13, 0},
-		{19, 13, 0},
-		{21, 13, 0},
-		{5, 11, 0},
-		{7, 11, 0},
-		{9, 11, 0},
-		{11, 11, 0},
-		{13, 11, 0},
-		{15, 11, 0},
-		{17, 11, 0},
-		{19, 11, 0},
-		{21, 11, 0},
-		{23, 11, 0},
-		{1, 8, 0},
-		{3, 9, 0},
-		{5, 9, 0},
-		{7, 9, 0},
-		{9, 9, 0},
-		{11, 9, 0},
-		{13, 9, 0},
-		{15, 9, 0},
-		{17, 9, 0},
-		{19, 9, 0},
-		{21, 9, 0},
-		{23, 9, 0},
-		{25, 9, 0},
-		{3, 7, 0},
-		{5, 7, 0},
-		{7, 7, 0},
-		{9, 7, 0},
-		{11, 7, 0},
-		{13, 7, 0},
-		{15, 7, 0},
-		{17, 7, 0},
-		{19, 7, 0},
-		{21, 7, 0},
-		{23, 7, 0},
-		{25, 7, 0},
-		{5, 5, 0},
-		{7, 5, 0},
-		{9, 5, 0},
-		{11, 5, 0},
-		{13, 5, 0},
-		{15, 5, 0},
-		{17, 5, 0},
-		{19, 5, 0},
-		{21, 5, 0},
-		{23, 5, 0},
-		{7, 3, 0},
-		{9, 3, 0},
-		{11, 3, 0},
-		{13, 3, 0},
-		{15, 3, 0},
-		{17, 3, 0},
-		{19, 3, 0},
-		{21, 3, 0},
-		{3, 1, 0},
-		{5, 1, 0},
-		{7, 1, 0},
-		{9, 1, 0},
-		{11, 1, 0},
-		{13, 1, 0},
-		{15, 1, 0},
-		{17, 1, 0},
-		{19, 1, 0},
-		{21, 1, 0},
-		{23, 1, 0},
-		{25, 1, 0},
-		{27, 8, 0},
-		{29, 8, 0},
-	} };
+	standard_chips,
+	CHIP_COUNT
+};
+
+static position_t difficult_chips[CHIP_COUNT] = {
+	{ 1, 7, 0 },
+	{ 21, 7, 0 },
+	{ 2, 2, 0 },
+	{ 2, 4, 0 },
+	{ 4, 2, 0 },
+	{ 4, 4, 0 },
+	{ 18, 2, 0 },
+	{ 18, 4, 0 },
+	{ 20, 2, 0 },
+	{ 20, 4, 0 },
+	{ 2, 10, 0 },
+	{ 2, 12, 0 },
+	{ 4, 10, 0 },
+	{ 4, 12, 0 },
+	{ 18, 10, 0 },
+	{ 18, 12, 0 },
+	{ 20, 10, 0 },
+	{ 20, 12, 0 },
+	{ 3, 6, 0 },
+	{ 3, 8, 0 },
+	{ 5, 6, 0 },
+	{ 5, 8, 0 },
+	{ 17, 6, 0 },
+	{ 17, 8, 0 },
+	{ 19, 6, 0 },
+	{ 19, 8, 0 },
+	{ 7, 5, 0 },
+	{ 7, 7, 0 },
+	{ 7, 9, 0 },
+	{ 9, 5, 0 },
+	{ 9, 7, 0 },
+	{ 9, 9, 0 },
+	{ 11, 5, 0 },
+	{ 11, 7, 0 },
+	{ 11, 9, 0 },
+	{ 13, 5, 0 },
+	{ 13, 7, 0 },
+	{ 13, 9, 0 },
+	{ 15, 5, 0 },
+	{ 15, 7, 0 },
+	{ 15, 9, 0 },
+	{ 7, 1, 0 },
+	{ 9, 1, 0 },
+	{ 11, 1, 0 },
+	{ 13, 1, 0 },
+	{ 15, 1, 0 },
+	{ 7, 13, 0 },
+	{ 9, 13, 0 },
+	{ 11, 13, 0 },
+	{ 13, 13, 0 },
+	{ 15, 13, 0 },
+	{ 6, 3, 0 },
+	{ 8, 3, 0 },
+	{ 10, 3, 0 },
+	{ 12, 3, 0 },
+	{ 14, 3, 0 },
+	{ 16, 3, 0 },
+	{ 6, 11, 0 },
+	{ 8, 11, 0 },
+	{ 10, 11, 0 },
+	{ 12, 11, 0 },
+	{ 14, 11, 0 },
+	{ 16, 11, 0 },
+	{ 8, 1, 1 },
+	{ 14, 1, 1 },
+	{ 8, 13, 1 },
+	{ 14, 13, 1 },
+	{ 3, 3, 1 },
+	{ 5, 3, 1 },
+	{ 7, 3, 1 },
+	{ 4, 5, 1 },
+	{ 4, 7, 1 },
+	{ 4, 9, 1 },
+	{ 6, 5, 1 },
+	{ 6, 7, 1 },
+	{ 6, 9, 1 },
+	{ 3, 11, 1 },
+	{ 5, 11, 1 },
+	{ 7, 11, 1 },
+	{ 15, 3, 1 },
+	{ 17, 3, 1 },
+	{ 19, 3, 1 },
+	{ 16, 5, 1 },
+	{ 16, 7, 1 },
+	{ 16, 9, 1 },
+	{ 18, 5, 1 },
+	{ 18, 7, 1 },
+	{ 18, 9, 1 },
+	{ 15, 11, 1 },
+	{ 17, 11, 1 },
+	{ 19, 11, 1 },
+	{ 10, 2, 1 },
+	{ 12, 2, 1 },
+	{ 9, 4, 1 },
+	{ 11, 4, 1 },
+	{ 13, 4, 1 },
+	{ 8, 6, 1 },
+	{ 8, 8, 1 },
+	{ 10, 6, 1 },
+	{ 10, 8, 1 },
+	{ 12, 6, 1 },
+	{ 12, 8, 1 },
+	{ 14, 6, 1 },
+	{ 14, 8, 1 },
+	{ 9, 10, 1 },
+	{ 11, 10, 1 },
+	{ 13, 10, 1 },
+	{ 10, 12, 1 },
+	{ 12, 12, 1 },
+	{ 6, 5, 2 },
+	{ 8, 5, 2 },
+	{ 10, 5, 2 },
+	{ 12, 5, 2 },
+	{ 14, 5, 2 },
+	{ 16, 5, 2 },
+	{ 5, 7, 2 },
+	{ 7, 7, 2 },
+	{ 9, 7, 2 },
+	{ 11, 7, 2 },
+	{ 13, 7, 2 },
+	{ 15, 7, 2 },
+	{ 17, 7, 2 },
+	{ 6, 9, 2 },
+	{ 8, 9, 2 },
+	{ 10, 9, 2 },
+	{ 12, 9, 2 },
+	{ 14, 9, 2 },
+	{ 16, 9, 2 },
+	{ 6, 7, 3 },
+	{ 16, 7, 3 },
+	{ 8, 6, 3 },
+	{ 8, 8, 3 },
+	{ 10, 6, 3 },
+	{ 10, 8, 3 },
+	{ 12, 6, 3 },
+	{ 12, 8, 3 },
+	{ 14, 6, 3 },
+	{ 14, 8, 3 },
+	{ 9, 7, 4 },
+	{ 11, 7, 4 },
+	{ 13, 7, 4 },
+	{ 10, 7, 5 },
+	{ 12, 7, 5 },
+	{ 11, 7, 6 },
+};
 
 map_t difficult_map = {
 	"Difficult",
 	16, 24,
-	{
-		{ 1, 7, 0 },
-		{ 21, 7, 0 },
-		{ 2, 2, 0 },
-		{ 2, 4, 0 },
-		{ 4, 2, 0 },
-		{ 4, 4, 0 },
-		{ 18, 2, 0 },
-		{ 18, 4, 0 },
-		{ 20, 2, 0 },
-		{ 20, 4, 0 },
-		{ 2, 10, 0 },
-		{ 2, 12, 0 },
-		{ 4, 10, 0 },
-		{ 4, 12, 0 },
-		{ 18, 10, 0 },
-		{ 18, 12, 0 },
-		{ 20, 10, 0 },
-		{ 20, 12, 0 },
-		{ 3, 6, 0 },
-		{ 3, 8, 0 },
-		{ 5, 6, 0 },
-		{ 5, 8, 0 },
-		{ 17, 6, 0 },
-		{ 17, 8, 0 },
-		{ 19, 6, 0 },
-		{ 19, 8, 0 },
-		{ 7, 5, 0 },
-		{ 7, 7, 0 },
-		{ 7, 9, 0 },
-		{ 9, 5, 0 },
-		{ 9, 7, 0 },
-		{ 9, 9, 0 },
-		{ 11, 5, 0 },
-		{ 11, 7, 0 },
-		{ 11, 9, 0 },
-		{ 13, 5, 0 },
-		{ 13, 7, 0 },
-		{ 13, 9, 0 },
-		{ 15, 5, 0 },
-		{ 15, 7, 0 },
-		{ 15, 9, 0 },
-		{ 7, 1, 0 },
-		{ 9, 1, 0 },
-		{ 11, 1, 0 },
-		{ 13, 1, 0 },
-		{ 15, 1, 0 },
-		{ 7, 13, 0 },
-		{ 9, 13, 0 },
-		{ 11, 13, 0 },
-		{ 13, 13, 0 },
-		{ 15, 13, 0 },
-		{ 6, 3, 0 },
-		{ 8, 3, 0 },
-		{ 10, 3, 0 },
-		{ 12, 3, 0 },
-		{ 14, 3, 0 },
-		{ 16, 3, 0 },
-		{ 6, 11, 0 },
-		{ 8, 11, 0 },
-		{ 10, 11, 0 },
-		{ 12, 11, 0 },
-		{ 14, 11, 0 },
-		{ 16, 11, 0 },
-		{ 8, 1, 1 },
-		{ 14, 1, 1 },
-		{ 8, 13, 1 },
-		{ 14, 13, 1 },
-		{ 3, 3, 1 },
-		{ 5, 3, 1 },
-		{ 7, 3, 1 },
-		{ 4, 5, 1 },
-		{ 4, 7, 1 },
-		{ 4, 9, 1 },
-		{ 6, 5, 1 },
-		{ 6, 7, 1 },
-		{ 6, 9, 1 },
-		{ 3, 11, 1 },
-		{ 5, 11, 1 },
-		{ 7, 11, 1 },
-		{ 15, 3, 1 },
-		{ 17, 3, 1 },
-		{ 19, 3, 1 },
-		{ 16, 5, 1 },
-		{ 16, 7, 1 },
-		{ 16, 9, 1 },
-		{ 18, 5, 1 },
-		{ 18, 7, 1 },
-		{ 18, 9, 1 },
-		{ 15, 11, 1 },
-		{ 17, 11, 1 },
-		{ 19, 11, 1 },
-		{ 10, 2, 1 },
-		{ 12, 2, 1 },
-		{ 9, 4, 1 },
-		{ 11, 4, 1 },
-		{ 13, 4, 1 },
-		{ 8, 6, 1 },
-		{ 8, 8, 1 },
-		{ 10, 6, 1 },
-		{ 10, 8, 1 },
-		{ 12, 6, 1 },
-		{ 12, 8, 1 },
-		{ 14, 6, 1 },
-		{ 14, 8, 1 },
-		{ 9, 10, 1 },
-		{ 11, 10, 1 },
-		{ 13, 10, 1 },
-		{ 10, 12, 1 },
-		{ 12, 12, 1 },
-		{ 6, 5, 2 },
-		{ 8, 5, 2 },
-		{ 10, 5, 2 },
-		{ 12, 5, 2 },
-		{ 14, 5, 2 },
-		{ 16, 5, 2 },
-		{ 5, 7, 2 },
-		{ 7, 7, 2 },
-		{ 9, 7, 2 },
-		{ 11, 7, 2 },
-		{ 13, 7, 2 },
-		{ 15, 7, 2 },
-		{ 17, 7, 2 },
-		{ 6, 9, 2 },
-		{ 8, 9, 2 },
-		{ 10, 9, 2 },
-		{ 12, 9, 2 },
-		{ 14, 9, 2 },
-		{ 16, 9, 2 },
-		{ 6, 7, 3 },
-		{ 16, 7, 3 },
-		{ 8, 6, 3 },
-		{ 8, 8, 3 },
-		{ 10, 6, 3 },
-		{ 10, 8, 3 },
-		{ 12, 6, 3 },
-		{ 12, 8, 3 },
-		{ 14, 6, 3 },
-		{ 14, 8, 3 },
-		{ 9, 7, 4 },
-		{ 11, 7, 4 },
-		{ 13, 7, 4 },
-		{ 10, 7, 5 },
-		{ 12, 7, 5 },
-		{ 11, 7, 6 },
-	}
+	difficult_chips,
+	CHIP_COUNT
+};
+
+static position_t four_bridges_chips[CHIP_COUNT] = {
+	{ 4, 1, 0 },
+	{ 6, 1, 0 },
+	{ 8, 1, 0 },
+	{ 10, 1, 0 },
+	{ 12, 1, 0 },
+	{ 14, 1, 0 },
+	{ 16, 1, 0 },
+	{ 18, 1, 0 },
+	{ 20, 1, 0 },
+	{ 22, 1, 0 },
+	{ 24, 1, 0 },
+	{ 6, 3, 0 },
+	{ 8, 3, 0 },
+	{ 10, 3, 0 },
+	{ 12, 3, 0 },
+	{ 16, 3, 0 },
+	{ 18, 3, 0 },
+	{ 20, 3, 0 },
+	{ 22, 3, 0 },
+	{ 6, 5, 0 },
+	{ 8, 5, 0 },
+	{ 10, 5, 0 },
+	{ 12, 5, 0 },
+	{ 14, 5, 0 },
+	{ 16, 5, 0 },
+	{ 18, 5, 0 },
+	{ 20, 5, 0 },
+	{ 22, 5, 0 },
+	{ 2, 7, 0 },
+	{ 4, 7, 0 },
+	{ 6, 7, 0 },
+	{ 8, 7, 0 },
+	{ 10, 7, 0 },
+	{ 12, 7, 0 },
+	{ 14, 7, 0 },
+	{ 16, 7, 0 },
+	{ 18, 7, 0 },
+	{ 20, 7, 0 },
+	{ 22, 7, 0 },
+	{ 24, 7, 0 },
+	{ 26, 7, 0 },
+	{ 5, 9, 0 },
+	{ 7, 9, 0 },
+	{ 9, 9, 0 },
+	{ 19, 9, 0 },
+	{ 21, 9, 0 },
+	{ 23, 9, 0 },
+	{ 2, 11, 0 },
+	{ 4, 11, 0 },
+	{ 6, 11, 0 },
+	{ 8, 11, 0 },
+	{ 10, 11, 0 },
+	{ 12, 11, 0 },
+	{ 14, 11, 0 },
+	{ 16, 11, 0 },
+	{ 18, 11, 0 },
+	{ 20, 11, 0 },
+	{ 22, 11, 0 },
+	{ 24, 11, 0 },
+	{ 26, 11, 0 },
+	{ 6, 13, 0 },
+	{ 8, 13, 0 },
+	{ 10, 13, 0 },
+	{ 12, 13, 0 },
+	{ 14, 13, 0 },
+	{ 16, 13, 0 },
+	{ 18, 13, 0 },
+	{ 20, 13, 0 },
+	{ 22, 13, 0 },
+	{ 6, 15, 0 },
+	{ 8, 15, 0 },
+	{ 10, 15, 0 },
+	{ 12, 15, 0 },
+	{ 16, 15, 0 },
+	{ 18, 15, 0 },
+	{ 20, 15, 0 },
+	{ 22, 15, 0 },
+	{ 4, 17, 0 },
+	{ 6, 17, 0 },
+	{ 8, 17, 0 },
+	{ 10, 17, 0 },
+	{ 12, 17, 0 },
+	{ 14, 17, 0 },
+	{ 16, 17, 0 },
+	{ 18, 17, 0 },
+	{ 20, 17, 0 },
+	{ 22, 17, 0 },
+	{ 24, 17, 0 },
+	{ 7, 2, 1 },
+	{ 7, 4, 1 },
+	{ 7, 6, 1 },
+	{ 9, 2, 1 },
+	{ 9, 4, 1 },
+	{ 9, 6, 1 },
+	{ 11, 2, 1 },
+	{ 11, 4, 1 },
+	{ 11, 6, 1 },
+	{ 17, 2, 1 },
+	{ 17, 4, 1 },
+	{ 17, 6, 1 },
+	{ 19, 2, 1 },
+	{ 19, 4, 1 },
+	{ 19, 6, 1 },
+	{ 21, 2, 1 },
+	{ 21, 4, 1 },
+	{ 21, 6, 1 },
+	{ 7, 12, 1 },
+	{ 7, 14, 1 },
+	{ 7, 16, 1 },
+	{ 9, 12, 1 },
+	{ 9, 14, 1 },
+	{ 9, 16, 1 },
+	{ 11, 12, 1 },
+	{ 11, 14, 1 },
+	{ 11, 16, 1 },
+	{ 17, 12, 1 },
+	{ 17, 14, 1 },
+	{ 17, 16, 1 },
+	{ 19, 12, 1 },
+	{ 19, 14, 1 },
+	{ 19, 16, 1 },
+	{ 21, 12, 1 },
+	{ 21, 14, 1 },
+	{ 21, 16, 1 },
+	{ 8, 3, 2 },
+	{ 8, 5, 2 },
+	{ 10, 3, 2 },
+	{ 10, 5, 2 },
+	{ 18, 3, 2 },
+	{ 18, 5, 2 },
+	{ 20, 3, 2 },
+	{ 20, 5, 2 },
+	{ 8, 13, 2 },
+	{ 8, 15, 2 },
+	{ 10, 13, 2 },
+	{ 10, 15, 2 },
+	{ 18, 13, 2 },
+	{ 18, 15, 2 },
+	{ 20, 13, 2 },
+	{ 20, 15, 2 },
+	{ 9, 4, 3 },
+	{ 19, 4, 3 },
+	{ 9, 14, 3 },
+	{ 19, 14, 3 },
 };
 
 map_t four_bridges_map = {
 	"Four Bridges",
 	20, 28,
-	{
-		{ 4, 1, 0 },
-		{ 6, 1, 0 },
-		{ 8, 1, 0 },
-		{ 10, 1, 0 },
-		{ 12, 1, 0 },
-		{ 14, 1, 0 },
-		{ 16, 1, 0 },
-		{ 18, 1, 0 },
-		{ 20, 1, 0 },
-		{ 22, 1, 0 },
-		{ 24, 1, 0 },
-		{ 6, 3, 0 },
-		{ 8, 3, 0 },
-		{ 10, 3, 0 },
-		{ 12, 3, 0 },
-		{ 16, 3, 0 },
-		{ 18, 3, 0 },
-		{ 20, 3, 0 },
-		{ 22, 3, 0 },
-		{ 6, 5, 0 },
-		{ 8, 5, 0 },
-		{ 10, 5, 0 },
-		{ 12, 5, 0 },
-		{ 14, 5, 0 },
-		{ 16, 5, 0 },
-		{ 18, 5, 0 },
-		{ 20, 5, 0 },
-		{ 22, 5, 0 },
-		{ 2, 7, 0 },
-		{ 4, 7, 0 },
-		{ 6, 7, 0 },
-		{ 8, 7, 0 },
-		{ 10, 7, 0 },
-		{ 12, 7, 0 },
-		{ 14, 7, 0 },
-		{ 16, 7, 0 },
-		{ 18, 7, 0 },
-		{ 20, 7, 0 },
-		{ 22, 7, 0 },
-		{ 24, 7, 0 },
-		{ 26, 7, 0 },
-		{ 5, 9, 0 },
-		{ 7, 9, 0 },
-		{ 9, 9, 0 },
-		{ 19, 9, 0 },
-		{ 21, 9, 0 },
-		{ 23, 9, 0 },
-		{ 2, 11, 0 },
-		{ 4, 11, 0 },
-		{ 6, 11, 0 },
-		{ 8, 11, 0 },
-		{ 10, 11, 0 },
-		{ 12, 11, 0 },
-		{ 14, 11, 0 },
-		{ 16, 11, 0 },
-		{ 18, 11, 0 },
-		{ 20, 11, 0 },
-		{ 22, 11, 0 },
-		{ 24, 11, 0 },
-		{ 26, 11, 0 },
-		{ 6, 13, 0 },
-		{ 8, 13, 0 },
-		{ 10, 13, 0 },
-		{ 12, 13, 0 },
-		{ 14, 13, 0 },
-		{ 16, 13, 0 },
-		{ 18, 13, 0 },
-		{ 20, 13, 0 },
-		{ 22, 13, 0 },
-		{ 6, 15, 0 },
-		{ 8, 15, 0 },
-		{ 10, 15, 0 },
-		{ 12, 15, 0 },
-		{ 16, 15, 0 },
-		{ 18, 15, 0 },
-		{ 20, 15, 0 },
-		{ 22, 15, 0 },
-		{ 4, 17, 0 },
-		{ 6, 17, 0 },
-		{ 8, 17, 0 },
-		{ 10, 17, 0 },
-		{ 12, 17, 0 },
-		{ 14, 17, 0 },
-		{ 16, 17, 0 },
-		{ 18, 17, 0 },
-		{ 20, 17, 0 },
-		{ 22, 17, 0 },
-		{ 24, 17, 0 },
-		{ 7, 2, 1 },
-		{ 7, 4, 1 },
-		{ 7, 6, 1 },
-		{ 9, 2, 1 },
-		{ 9, 4, 1 },
-		{ 9, 6, 1 },
-		{ 11, 2, 1 },
-		{ 11, 4, 1 },
-		{ 11, 6, 1 },
-		{ 17, 2, 1 },
-		{ 17, 4, 1 },
-		{ 17, 6, 1 },
-		{ 19, 2, 1 },
-		{ 19, 4, 1 },
-		{ 19, 6, 1 },
-		{ 21, 2, 1 },
-		{ 21, 4, 1 },
-		{ 21, 6, 1 },
-		{ 7, 12, 1 },
-		{ 7, 14, 1 },
-		{ 7, 16, 1 },
-		{ 9, 12, 1 },
-		{ 9, 14, 1 },
-		{ 9, 16, 1 },
-		{ 11, 12, 1 },
-		{ 11, 14, 1 },
-		{ 11, 16, 1 },
-		{ 17, 12, 1 },
-		{ 17, 14, 1 },
-		{ 17, 16, 1 },
-		{ 19, 12, 1 },
-		{ 19, 14, 1 },
-		{ 19, 16, 1 },
-		{ 21, 12, 1 },
-		{ 21, 14, 1 },
-		{ 21, 16, 1 },
-		{ 8, 3, 2 },
-		{ 8, 5, 2 },
-		{ 10, 3, 2 },
-		{ 10, 5, 2 },
-		{ 18, 3, 2 },
-		{ 18, 5, 2 },
-		{ 20, 3, 2 },
-		{ 20, 5, 2 },
-		{ 8, 13, 2 },
-		{ 8, 15, 2 },
-		{ 10, 13, 2 },
-		{ 10, 15, 2 },
-		{ 18, 13, 2 },
-		{ 18, 15, 2 },
-		{ 20, 13, 2 },
-		{ 20, 15, 2 },
-		{ 9, 4, 3 },
-		{ 19, 4, 3 },
-		{ 9, 14, 3 },
-		{ 19, 14, 3 },
-	}
+	four_bridges_chips,
+	CHIP_COUNT
 };
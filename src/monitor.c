@@ -0,0 +1,183 @@
+#define _GNU_SOURCE /* SCHED_IDLE */
+#include <sched.h>
+#include <string.h>
+#include "monitor.h"
+#include "beam.h"
+#include "common.h"
+#include "layout.h"
+
+static int same_deal(const board_t *a, const layout_t *layout, const chip_t *chip)
+{
+	return a->layout == layout && !memcmp(a->chip, chip, layout->slot_count);
+}
+
+/* The entry of the position in its bucket, or the one to make room in if it is not there */
+static monitor_entry_t *cache_entry(monitor_t *monitor, const board_state_t *state)
+{
+	int i;
+	const unsigned int hash = board_state_hash(state);
+	monitor_entry_t *bucket = &monitor->cache[hash & (MONITOR_CACHE_SIZE - MONITOR_CACHE_WAYS)];
+
+	for(i = 0; i < MONITOR_CACHE_WAYS; ++i)
+		if(bucket[i].answer == MONITOR_PENDING || !memcmp(&bucket[i].state, state, sizeof(board_state_t)))
+			return &bucket[i];
+	return &bucket[(hash >> 16) % MONITOR_CACHE_WAYS];
+}
+
+static monitor_answer_t look_at(monitor_t *monitor, const board_t *board)
+{
+	int result;
+	beam_limits_t beam_limits = beam_default_limits;
+	solver_limits_t limits = { 0, MONITOR_TIME_LIMIT * (1 - MONITOR_BEAM_SHARE), &monitor->cancel };
+
+	if(board->tile_count == 0)
+		return MONITOR_WINNABLE;
+	if(board->free_pair_count == 0 || board_deadlocked(board))
+		return MONITOR_LOST;
+
+	beam_limits.time_limit = MONITOR_TIME_LIMIT * MONITOR_BEAM_SHARE;
+	beam_limits.cancel = &monitor->cancel;
+	result = solve_board_beam(board, &beam_limits, NULL, NULL);
+	if(result == SOLVER_UNKNOWN && !__atomic_load_n(&monitor->cancel, __ATOMIC_RELAXED))
+		result = solve_board(monitor->solver, board, &limits, NULL, NULL);
+	return result == 1 ? MONITOR_WINNABLE : result == 0 ? MONITOR_LOST : MONITOR_UNKNOWN;
+}
+
+static void *run_worker(void *arg)
+{
+	monitor_t *monitor = (monitor_t *) arg;
+	board_t *board = (board_t *) malloc(sizeof(board_t));
+
+#ifdef SCHED_IDLE
+	/* Only ever runs when the game has nothing to do */
+	{
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+	}
+#endif
+
+	pthread_mutex_lock(&monitor->mutex);
+	while(!monitor->stop) {
+		monitor_answer_t answer;
+
+		if(!monitor->asked) {
+			pthread_cond_wait(&monitor->wake, &monitor->mutex);
+			continue;
+		}
+		*board = monitor->board;
+		monitor->asked = 0;
+		monitor->busy = 1;
+		__atomic_store_n(&monitor->cancel, 0, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&monitor->mutex);
+
+		answer = look_at(monitor, board);
+
+		pthread_mutex_lock(&monitor->mutex);
+		/* Running out of time is worth remembering, being cancelled is not */
+		if(answer != MONITOR_UNKNOWN || !monitor->cancel) {
+			if(same_deal(board, monitor->layout, monitor->chip)) {
+				monitor_entry_t *entry = cache_entry(monitor, &board->state);
+				entry->state = board->state;
+				entry->answer = answer;
+			}
+		}
+		monitor->busy = 0;
+		pthread_cond_broadcast(&monitor->idle);
+	}
+	pthread_mutex_unlock(&monitor->mutex);
+
+	free(board);
+	return NULL;
+}
+
+monitor_t *monitor_create(void)
+{
+	monitor_t *monitor = (monitor_t *) calloc(1, sizeof(monitor_t));
+
+	if(monitor == NULL)
+		return NULL;
+	monitor->solver = solver_create(MONITOR_TABLE_BITS);
+	if(monitor->solver == NULL) {
+		free(monitor);
+		return NULL;
+	}
+	pthread_mutex_init(&monitor->mutex, NULL);
+	pthread_cond_init(&monitor->wake, NULL);
+	pthread_cond_init(&monitor->idle, NULL);
+	monitor->thread_running = pthread_create(&monitor->thread, NULL, run_worker, monitor) == 0;
+	if(!monitor->thread_running) {
+		monitor_destroy(monitor);
+		return NULL;
+	}
+	return monitor;
+}
+
+void monitor_destroy(monitor_t *monitor)
+{
+	if(monitor == NULL)
+		return;
+
+	pthread_mutex_lock(&monitor->mutex);
+	monitor->stop = 1;
+	__atomic_store_n(&monitor->cancel, 1, __ATOMIC_RELAXED);
+	pthread_cond_signal(&monitor->wake);
+	pthread_mutex_unlock(&monitor->mutex);
+	if(monitor->thread_running)
+		pthread_join(monitor->thread, NULL);
+
+	solver_free(monitor->solver);
+	pthread_cond_destroy(&monitor->wake);
+	pthread_cond_destroy(&monitor->idle);
+	pthread_mutex_destroy(&monitor->mutex);
+	free(monitor);
+}
+
+void monitor_forget(monitor_t *monitor)
+{
+	if(monitor == NULL)
+		return;
+
+	pthread_mutex_lock(&monitor->mutex);
+	monitor->asked = 0;
+	__atomic_store_n(&monitor->cancel, 1, __ATOMIC_RELAXED);
+	while(monitor->busy)
+		pthread_cond_wait(&monitor->idle, &monitor->mutex);
+	memset(monitor->cache, 0, sizeof(monitor->cache));
+	monitor->layout = NULL;
+	monitor->board.layout = NULL;
+	pthread_mutex_unlock(&monitor->mutex);
+}
+
+monitor_answer_t monitor_ask(monitor_t *monitor, const board_t *board)
+{
+	const monitor_entry_t *entry;
+	monitor_answer_t answer = MONITOR_PENDING;
+
+	pthread_mutex_lock(&monitor->mutex);
+
+	/* The answers are about other chips, the worker's included */
+	if(monitor->layout == NULL || !same_deal(board, monitor->layout, monitor->chip)) {
+		memset(monitor->cache, 0, sizeof(monitor->cache));
+		monitor->layout = board->layout;
+		memcpy(monitor->chip, board->chip, board->layout->slot_count);
+		monitor->board.layout = NULL;
+		monitor->asked = 0;
+		__atomic_store_n(&monitor->cancel, 1, __ATOMIC_RELAXED);
+	}
+
+	entry = cache_entry(monitor, &board->state);
+	if(entry->answer != MONITOR_PENDING && !memcmp(&entry->state, &board->state, sizeof(board_state_t))) {
+		answer = (monitor_answer_t) entry->answer;
+	}
+	/* Unless the worker has it already, the position it is on is not wanted any more */
+	else if(!(monitor->asked || monitor->busy) || monitor->board.layout == NULL || memcmp(&monitor->board.state, &board->state, sizeof(board_state_t))) {
+		monitor->board = *board;
+		monitor->asked = 1;
+		__atomic_store_n(&monitor->cancel, 1, __ATOMIC_RELAXED);
+		pthread_cond_signal(&monitor->wake);
+	}
+
+	pthread_mutex_unlock(&monitor->mutex);
+	return answer;
+}
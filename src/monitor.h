@@ -0,0 +1,74 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <pthread.h>
+#include "board.h"
+#include "solver.h"
+
+/*
+	Finds out in the background whether the game can still be won, so the
+	player learns about a losing move when it is made. A worker thread
+	looks at the position asked about last, first with the beam search,
+	which finds most winning lines quickly, then with the exact solver
+	for the rest of the time limit. A newer question cancels the search.
+	The answers are kept per position, so going back and forth with undo
+	asks the worker nothing.
+*/
+typedef enum {
+	MONITOR_PENDING, /* The worker is on it or hasn't got to it */
+	MONITOR_WINNABLE,
+	MONITOR_LOST,
+	MONITOR_UNKNOWN /* The time ran out */
+} monitor_answer_t;
+
+#define MONITOR_CACHE_SIZE 512 /* Positions remembered, a power of two */
+#define MONITOR_CACHE_WAYS 4 /* Positions sharing a bucket */
+#define MONITOR_TABLE_BITS 15
+#define MONITOR_TIME_LIMIT 2.0 /* Seconds per position */
+#define MONITOR_BEAM_SHARE 0.1 /* Of the time limit */
+
+typedef struct {
+	board_state_t state;
+	int answer; /* MONITOR_PENDING for an empty entry */
+} monitor_entry_t;
+
+typedef struct {
+	monitor_entry_t cache[MONITOR_CACHE_SIZE];
+	/* Deal the cache is valid for */
+	const layout_t *layout;
+	chip_t chip[MAX_SLOT_COUNT];
+
+	board_t board; /* Position asked about last */
+	int asked; /* board waits for the worker */
+	int busy; /* The worker is looking at board */
+	int cancel; /* Stops the search of the worker */
+	solver_t *solver;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake; /* Signalled when there is a position to look at */
+	pthread_cond_t idle; /* Signalled when the worker is done with a position */
+	pthread_t thread;
+	int thread_running;
+	int stop;
+} monitor_t;
+
+/* Returns NULL if the worker couldn't be started */
+monitor_t *monitor_create(void);
+/* Stops the worker */
+void monitor_destroy(monitor_t *monitor);
+
+/*
+	Cancels the search, waits for the worker to let go of the board and
+	forgets every answer. Has to be called before the layout of a board
+	asked about is freed, the wait is at most the beam search's share of
+	the time limit.
+*/
+void monitor_forget(monitor_t *monitor);
+
+/*
+	Returns the answer about the board if it is known and MONITOR_PENDING
+	after handing the board to the worker otherwise. Never waits for the
+	worker, so it can be called whenever the board is drawn.
+*/
+monitor_answer_t monitor_ask(monitor_t *monitor, const board_t *board);
+
+#endif
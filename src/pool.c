@@ -0,0 +1,270 @@
+#include <string.h>
+#include "pool.h"
+#include "common.h"
+#include "layout.h"
+#include "storage.h"
+
+deal_pool_t *deal_pool_create(uint64_t seed)
+{
+	deal_pool_t *pool = (deal_pool_t *) calloc(1, sizeof(deal_pool_t));
+
+	rng_seed(&pool->rng, seed);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+	pool->busy_entry = -1;
+	return pool;
+}
+
+void deal_pool_destroy(deal_pool_t *pool)
+{
+	int i;
+
+	if(pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	if(pool->thread_running)
+		pthread_join(pool->thread, NULL);
+
+	generator_free(pool->gen);
+	for(i = 0; i < pool->entry_count; ++i)
+		map_free(&pool->entry[i].map);
+	pthread_cond_destroy(&pool->idle);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool);
+}
+
+static int find_entry(const deal_pool_t *pool, unsigned int hash)
+{
+	int i;
+
+	for(i = 0; i < pool->entry_count; ++i)
+		if(pool->entry[i].hash == hash)
+			return i;
+	return -1;
+}
+
+/* The map with the fewest deals that still needs some, or -1 */
+static int entry_to_fill(const deal_pool_t *pool)
+{
+	int i;
+	int best = -1;
+
+	for(i = 0; i < pool->entry_count; ++i) {
+		const deal_pool_entry_t *entry = &pool->entry[i];
+		if(entry->failed || entry->count == DEAL_POOL_SIZE)
+			continue;
+		if(best < 0 || entry->count < pool->entry[best].count)
+			best = i;
+	}
+	return best;
+}
+
+int deal_pool_add_map(deal_pool_t *pool, map_t *map)
+{
+	int i;
+	unsigned int hash;
+	deal_pool_entry_t *entry;
+	const layout_t *layout = map_layout(map);
+
+	if(layout == NULL)
+		return 0;
+	hash = layout_hash(layout);
+
+	pthread_mutex_lock(&pool->mutex);
+	if(find_entry(pool, hash) >= 0) {
+		pthread_mutex_unlock(&pool->mutex);
+		return 1;
+	}
+
+	if(pool->entry_count < DEAL_POOL_MAPS) {
+		i = pool->entry_count++;
+	}
+	else {
+		i = DEAL_POOL_MAPS - 1;
+		/* The worker uses the map without holding the lock */
+		while(pool->busy_entry == i)
+			pthread_cond_wait(&pool->idle, &pool->mutex);
+		if(pool->gen != NULL && pool->gen_entry == i) {
+			generator_free(pool->gen);
+			pool->gen = NULL;
+		}
+		map_free(&pool->entry[i].map);
+	}
+
+	entry = &pool->entry[i];
+	entry->map = *map;
+	entry->map.name = NULL;
+	entry->map.chip = (position_t *) malloc(sizeof(position_t) * map->chip_count);
+	memcpy(entry->map.chip, map->chip, sizeof(position_t) * map->chip_count);
+	entry->map.block = (position_t *) malloc(sizeof(position_t) * (map->block_count + 1));
+	memcpy(entry->map.block, map->block, sizeof(position_t) * map->block_count);
+	entry->map.layout = NULL;
+	map_layout(&entry->map);
+	entry->hash = hash;
+	entry->failed = 0;
+	entry->count = 0;
+
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	return 1;
+}
+
+int deal_pool_take(deal_pool_t *pool, map_t *map, board_t *board, uint32_t *seed)
+{
+	int i;
+	int result = 0;
+	const layout_t *layout = map_layout(map);
+
+	if(layout == NULL)
+		return 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	i = find_entry(pool, layout_hash(layout));
+	if(i >= 0) {
+		deal_pool_entry_t *entry = &pool->entry[i];
+		if(entry->count > 0) {
+			--entry->count;
+			*board = entry->deal[entry->count];
+			*seed = entry->seed[entry->count];
+			/* Same slots, but the deal points to the pool's copy of the layout */
+			board->layout = layout;
+			result = 1;
+		}
+		entry->failed = 0;
+		pthread_cond_signal(&pool->wake);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return result;
+}
+
+int deal_pool_put(deal_pool_t *pool, const board_t *board, uint32_t seed)
+{
+	int i;
+	int result = 0;
+	const unsigned int hash = layout_hash(board->layout);
+
+	pthread_mutex_lock(&pool->mutex);
+	i = find_entry(pool, hash);
+	if(i >= 0 && pool->entry[i].count < DEAL_POOL_SIZE) {
+		deal_pool_entry_t *entry = &pool->entry[i];
+		entry->deal[entry->count] = *board;
+		entry->deal[entry->count].layout = entry->map.layout;
+		entry->seed[entry->count] = seed;
+		++entry->count;
+		result = 1;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return result;
+}
+
+/*
+	The time limit would count the pauses between slices, or the time the
+	worker waits for the CPU, and leave a deal a fraction of its budget.
+	The node and restart limits bound the search anyway, and they alone
+	decide the deal.
+*/
+static void pool_limits(generator_limits_t *limits)
+{
+	*limits = generator_default_limits;
+	limits->time_limit = 0;
+}
+
+int deal_pool_fill(deal_pool_t *pool, double slice)
+{
+	int result;
+	generator_limits_t limits;
+
+	pool_limits(&limits);
+	if(pool->thread_running)
+		return 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	if(pool->gen == NULL) {
+		const int i = entry_to_fill(pool);
+		if(i < 0) {
+			pthread_mutex_unlock(&pool->mutex);
+			return 0;
+		}
+		pool->gen = generator_start(&pool->entry[i].map, rng_next(&pool->rng), DIFFICULTY_NORMAL, &limits);
+		pool->gen_entry = i;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	result = generator_step(pool->gen, slice);
+	if(result == GENERATOR_RUNNING)
+		return 1;
+
+	pthread_mutex_lock(&pool->mutex);
+	{
+		deal_pool_entry_t *entry = &pool->entry[pool->gen_entry];
+		if(!result)
+			entry->failed = 1;
+		else if(entry->count < DEAL_POOL_SIZE) {
+			generator_stats_t stats;
+			generator_deal(pool->gen, &entry->deal[entry->count], &stats);
+			entry->seed[entry->count] = stats.seed;
+			++entry->count;
+		}
+	}
+	generator_free(pool->gen);
+	pool->gen = NULL;
+	pthread_mutex_unlock(&pool->mutex);
+	return 1;
+}
+
+static void *run_worker(void *arg)
+{
+	deal_pool_t *pool = (deal_pool_t *) arg;
+	board_t *board = (board_t *) malloc(sizeof(board_t));
+	generator_limits_t limits;
+
+	pool_limits(&limits);
+
+	pthread_mutex_lock(&pool->mutex);
+	while(!pool->stop) {
+		int result;
+		uint32_t seed;
+		deal_pool_entry_t *entry;
+		const int i = entry_to_fill(pool);
+
+		if(i < 0) {
+			pthread_cond_wait(&pool->wake, &pool->mutex);
+			continue;
+		}
+
+		pool->busy_entry = i;
+		seed = rng_next(&pool->rng);
+		pthread_mutex_unlock(&pool->mutex);
+		result = generate_board(board, &pool->entry[i].map, seed, DIFFICULTY_NORMAL, &limits, NULL);
+		pthread_mutex_lock(&pool->mutex);
+		pool->busy_entry = -1;
+
+		entry = &pool->entry[i];
+		if(!result)
+			entry->failed = 1;
+		else if(entry->count < DEAL_POOL_SIZE) {
+			entry->deal[entry->count] = *board;
+			entry->seed[entry->count] = seed;
+			++entry->count;
+		}
+		pthread_cond_broadcast(&pool->idle);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	free(board);
+	return NULL;
+}
+
+int deal_pool_start(deal_pool_t *pool)
+{
+	if(pool->thread_running)
+		return 1;
+	pool->thread_running = pthread_create(&pool->thread, NULL, run_worker, pool) == 0;
+	return pool->thread_running;
+}
@@ -0,0 +1,63 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include "board.h"
+#include "common.h"
+
+#define DEAL_POOL_MAPS 4 /* The built-in maps and the last custom one */
+#define DEAL_POOL_SIZE 3 /* Deals kept ready per map */
+
+typedef struct {
+	map_t map; /* Own copy, the caller's map may go away */
+	unsigned int hash; /* layout_hash() of the map */
+	int failed; /* No deal found last time, don't try again before the next take */
+	board_t deal[DEAL_POOL_SIZE];
+	uint32_t seed[DEAL_POOL_SIZE]; /* The deals were made from */
+	int count;
+} deal_pool_entry_t;
+
+/*
+	Normal deals generated ahead of time, so a new game only has to copy a board.
+	The pool is filled either in slices from the caller's idle time or by a
+	worker thread, all functions may be called while the worker runs.
+*/
+typedef struct {
+	deal_pool_entry_t entry[DEAL_POOL_MAPS];
+	int entry_count;
+	generator_t *gen; /* Deal in progress when filling in slices */
+	int gen_entry;
+	rng_t rng; /* Seeds of new deals */
+	pthread_mutex_t mutex;
+	pthread_cond_t wake; /* Signalled when there is something to fill */
+	pthread_cond_t idle; /* Signalled when the worker is done with an entry */
+	int busy_entry; /* Entry the worker is generating for or -1 */
+	pthread_t thread;
+	int thread_running;
+	int stop;
+} deal_pool_t;
+
+deal_pool_t *deal_pool_create(uint64_t seed);
+/* Stops the worker if there is one */
+void deal_pool_destroy(deal_pool_t *pool);
+
+/*
+	Keeps deals for the map from now on, returns 0 on invalid maps. When
+	all entries are in use the one added last makes room, so the maps added
+	first stay and the last custom map takes the remaining entry.
+*/
+int deal_pool_add_map(deal_pool_t *pool, map_t *map);
+
+/* Moves a ready deal for the map and its seed out, returns 0 if there is none */
+int deal_pool_take(deal_pool_t *pool, map_t *map, board_t *board, uint32_t *seed);
+
+/* Adds a deal, for reading the pool back, returns 0 if its map is unknown or full */
+int deal_pool_put(deal_pool_t *pool, const board_t *board, uint32_t seed);
+
+/* Generates for about slice seconds, returns 0 once every map has its deals */
+int deal_pool_fill(deal_pool_t *pool, double slice);
+
+/* Fills the pool on a thread of its own instead, returns 0 if it couldn't be started */
+int deal_pool_start(deal_pool_t *pool);
+
+#endif
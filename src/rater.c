@@ -0,0 +1,246 @@
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "rater.h"
+#include "common.h"
+#include "layout.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+	const board_t *board;
+	rater_policy_t policy;
+	int games;
+	uint64_t seed;
+	int next_game; /* Taken by the players as they go */
+} table_t;
+
+typedef struct {
+	table_t *table;
+	board_t board;
+	int won;
+	long tiles_left;
+} player_t;
+
+/* Counts the chips in the list that are not free but would be, each once */
+static int count_freed(const board_t *board, const int *list, int start, int end, unsigned int *seen)
+{
+	int i, freed = 0;
+
+	for(i = start; i < end; ++i) {
+		const int s = list[i];
+
+		if((seen[s / 32] >> (s % 32)) & 1)
+			continue;
+		seen[s / 32] |= 1u << (s % 32);
+		freed += !((board->free.member[s / 32] >> (s % 32)) & 1) && layout_selectable(board->layout, board, s);
+	}
+	return freed;
+}
+
+/* Takes the chips of the move off or puts them back in the removed bits only, the free set stays as it was */
+static void flip_move(board_t *board, const move_t *move)
+{
+	board->state.removed[move->slot1 / 32] ^= 1u << (move->slot1 % 32);
+	board->state.removed[move->slot2 / 32] ^= 1u << (move->slot2 % 32);
+}
+
+/*
+	Chips the move would free. Flipping the removed bits is much cheaper
+	than taking the chips off and putting them back with the free set kept
+	up to date.
+*/
+static int chips_freed(board_t *board, const move_t *move)
+{
+	int k, freed = 0;
+	unsigned int seen[SLOT_WORDS];
+	const int slots[2] = { move->slot1, move->slot2 };
+	const layout_t *layout = board->layout;
+
+	memset(seen, 0, sizeof(seen));
+	flip_move(board, move);
+	for(k = 0; k < 2; ++k) {
+		const int s = slots[k];
+
+		freed += count_freed(board, layout->below, layout->below_start[s], layout->below_start[s + 1], seen);
+		freed += count_freed(board, layout->left, layout->left_start[s], layout->left_start[s + 1], seen);
+		freed += count_freed(board, layout->right, layout->right_start[s], layout->right_start[s + 1], seen);
+	}
+	flip_move(board, move);
+	return freed;
+}
+
+static int deadlocks(board_t *board, const move_t *move)
+{
+	int deadlocked;
+
+	flip_move(board, move);
+	deadlocked = board_deadlocked_by(board, move);
+	flip_move(board, move);
+	return deadlocked;
+}
+
+/*
+	A safe move if there is one, else one of the moves freeing the most
+	chips at random. Only the move picked is checked for leaving a class
+	with no way to be cleared, which takes longer than scoring all of them,
+	and the next best is picked while it does.
+*/
+static move_t greedy_move(board_t *board, rng_t *rng, const unsigned char *class_left, const move_t *moves, int count)
+{
+	int i;
+	int score[MAX_MOVE_COUNT];
+
+	for(i = 0; i < count; ++i) {
+		const int c = board->chip_class[moves[i].slot1];
+
+		/* When all chips of a class are free, taking two of them can't hurt */
+		if(class_left[c] == board->free_class_count[c])
+			return moves[i];
+		score[i] = chips_freed(board, &moves[i]);
+	}
+
+	for(;;) {
+		int best = -1, best_score = -1, ties = 0;
+
+		for(i = 0; i < count; ++i) {
+			if(score[i] < 0)
+				continue;
+			if(score[i] > best_score) {
+				best = i;
+				best_score = score[i];
+				ties = 1;
+			}
+			else if(score[i] == best_score && rng_range(rng, ++ties) == 0) {
+				best = i;
+			}
+		}
+		/* Every move loses, any will do */
+		if(best < 0)
+			return moves[0];
+		if(!deadlocks(board, &moves[best]))
+			return moves[best];
+		score[best] = -1;
+	}
+}
+
+/* Plays the board to the end, returns the tiles left */
+static int play(board_t *board, rater_policy_t policy, rng_t *rng)
+{
+	int i, count;
+	move_t moves[MAX_MOVE_COUNT];
+	unsigned char class_left[CHIP_CLASS_COUNT];
+	const layout_t *layout = board->layout;
+
+	memset(class_left, 0, sizeof(class_left));
+	for(i = 0; i < layout->slot_count; ++i)
+		if(!board_removed(board, i) && !layout->blocker[i])
+			++class_left[board->chip_class[i]];
+
+	while((count = board_moves(board, moves, MAX_MOVE_COUNT)) > 0) {
+		const move_t move = policy == RATER_GREEDY
+			? greedy_move(board, rng, class_left, moves, count)
+			: moves[rng_range(rng, count)];
+
+		class_left[board->chip_class[move.slot1]] -= 2;
+		board_remove_chip(board, move.slot1);
+		board_remove_chip(board, move.slot2);
+	}
+	return board->tile_count;
+}
+
+static void *run_player(void *arg)
+{
+	player_t *player = (player_t *) arg;
+	table_t *table = player->table;
+	rng_t rng;
+	int game;
+
+	while((game = __atomic_fetch_add(&table->next_game, 1, __ATOMIC_RELAXED)) < table->games) {
+		int left;
+
+		player->board = *table->board;
+		rng_seed(&rng, table->seed + game);
+		left = play(&player->board, table->policy, &rng);
+		player->won += left == 0;
+		player->tiles_left += left;
+	}
+	return NULL;
+}
+
+/* Wilson score interval for 95% confidence, it stays inside 0 ... 1 even near the ends */
+static void confidence_interval(rating_t *rating)
+{
+	const double z = 1.96;
+	const double n = rating->games;
+	const double p = rating->win_rate;
+	const double centre = p + z * z / (2 * n);
+	const double spread = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+	const double scale = 1 + z * z / n;
+
+	rating->low = (centre - spread) / scale;
+	rating->high = (centre + spread) / scale;
+	if(rating->low < 0)
+		rating->low = 0;
+	if(rating->high > 1)
+		rating->high = 1;
+}
+
+int rate_board(const board_t *board, rater_policy_t policy, int games, int thread_count, uint64_t seed, rating_t *rating)
+{
+	int i;
+	long tiles_left = 0;
+	table_t table;
+	player_t *players;
+	pthread_t threads[RATER_MAX_THREADS];
+	unsigned char started[RATER_MAX_THREADS];
+	const double start = now();
+
+	memset(rating, 0, sizeof(rating_t));
+	if(board->layout == NULL || games <= 0)
+		return 0;
+	if(thread_count < 1)
+		thread_count = 1;
+	if(thread_count > RATER_MAX_THREADS)
+		thread_count = RATER_MAX_THREADS;
+	if(thread_count > games)
+		thread_count = games;
+
+	players = (player_t *) calloc(thread_count, sizeof(player_t));
+	if(players == NULL)
+		return 0;
+	table.board = board;
+	table.policy = policy;
+	table.games = games;
+	table.seed = seed;
+	table.next_game = 0;
+
+	for(i = 0; i < thread_count; ++i)
+		players[i].table = &table;
+	for(i = 1; i < thread_count; ++i)
+		started[i] = pthread_create(&threads[i], NULL, run_player, &players[i]) == 0;
+	/* The calling thread plays as well, and whatever the others could not start */
+	run_player(&players[0]);
+	for(i = 1; i < thread_count; ++i)
+		if(started[i])
+			pthread_join(threads[i], NULL);
+
+	rating->games = games;
+	for(i = 0; i < thread_count; ++i) {
+		rating->won += players[i].won;
+		tiles_left += players[i].tiles_left;
+	}
+	free(players);
+
+	rating->win_rate = (double) rating->won / games;
+	rating->tiles_left = (double) tiles_left / games;
+	confidence_interval(rating);
+	rating->seconds = now() - start;
+	return 1;
+}
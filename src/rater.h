@@ -0,0 +1,41 @@
+#ifndef RATER_H
+#define RATER_H
+
+#include <stdint.h>
+#include "board.h"
+
+/*
+	Rates how hard a deal is by playing it many times to the end without
+	looking ahead and counting the games won. Random players take any legal
+	move, greedy ones take two chips of a class that is all free when they
+	can, avoid moves that leave a class with no way to be cleared and
+	otherwise free the most chips. The share won is the difficulty score,
+	with a 95% confidence interval around it.
+*/
+typedef enum {
+	RATER_RANDOM,
+	RATER_GREEDY,
+	RATER_POLICY_COUNT
+} rater_policy_t;
+
+#define RATER_DEFAULT_GAMES 4096
+#define RATER_MAX_THREADS 64
+
+typedef struct {
+	int games;
+	int won;
+	double win_rate; /* won / games */
+	double low, high; /* Wilson score interval of the win rate */
+	double tiles_left; /* Mean over all games, won ones included */
+	double seconds;
+} rating_t;
+
+/*
+	Plays games on thread_count threads (the calling one included), each
+	with its own board and RNG. Game i is played from seed + i whichever
+	thread plays it, so the rating only depends on the seed and not on the
+	threads. Returns 0 if the board has no layout or games is not positive.
+*/
+int rate_board(const board_t *board, rater_policy_t policy, int games, int thread_count, uint64_t seed, rating_t *rating);
+
+#endif
@@ -0,0 +1,251 @@
+#include <string.h>
+#include "session.h"
+#include "common.h"
+
+/* The position changed */
+static void forget_hints(game_session_t *session)
+{
+	session->hint_index = 0;
+	session->hints.ready = 0;
+}
+
+game_session_t *session_create(void)
+{
+	game_session_t *session = (game_session_t *) calloc(1, sizeof(game_session_t));
+	session->generator_threads = 1;
+	rng_seed(&session->rng, 0);
+	return session;
+}
+
+void session_seed(game_session_t *session, uint64_t seed)
+{
+	rng_seed(&session->rng, seed);
+}
+
+void session_destroy(game_session_t *session)
+{
+	if(session == NULL)
+		return;
+
+	session_cancel_deal(session);
+	layout_free(&session->saved_layout);
+	free(session);
+}
+
+int session_new_game(game_session_t *session, map_t *map)
+{
+	if(map_layout(map) == NULL)
+		return 0;
+
+	session->undo_count = 0;
+	forget_hints(session);
+	if(!generate_board_parallel(&session->board, map, rng_next(&session->rng), session->difficulty, session->generator_threads, NULL, &session->generator_stats))
+		return 0;
+	session->deal_id = make_deal_id(map, session->generator_stats.seed, session->difficulty);
+	session->row_count = map->row_count;
+	session->col_count = map->col_count;
+	return 1;
+}
+
+void session_use_deal(game_session_t *session, map_t *map, const board_t *deal, uint32_t seed)
+{
+	session_cancel_deal(session);
+	session->board = *deal;
+	session->undo_count = 0;
+	forget_hints(session);
+	memset(&session->generator_stats, 0, sizeof(generator_stats_t));
+	session->generator_stats.seed = seed;
+	session->deal_id = make_deal_id(map, seed, DIFFICULTY_NORMAL);
+	session->row_count = map->row_count;
+	session->col_count = map->col_count;
+}
+
+int session_replay_deal(game_session_t *session, map_t *map, const deal_id_t *id)
+{
+	board_t *deal = (board_t *) malloc(sizeof(board_t));
+	const int result = generate_deal(deal, map, id);
+
+	if(result) {
+		session_use_deal(session, map, deal, id->seed);
+		session->deal_id = *id;
+	}
+	free(deal);
+	return result;
+}
+
+int session_start_deal(game_session_t *session, map_t *map)
+{
+	session_cancel_deal(session);
+	session->dealing = generator_start(map, rng_next(&session->rng), session->difficulty, NULL);
+	session->dealing_map = map;
+	return session->dealing != NULL;
+}
+
+int session_continue_deal(game_session_t *session, double slice)
+{
+	int result;
+
+	if(session->dealing == NULL)
+		return 0;
+
+	result = generator_step(session->dealing, slice);
+	if(result == GENERATOR_RUNNING)
+		return GENERATOR_RUNNING;
+
+	if(result) {
+		generator_deal(session->dealing, &session->board, &session->generator_stats);
+		session->deal_id = make_deal_id(session->dealing_map, session->generator_stats.seed, session->difficulty);
+		session->undo_count = 0;
+		forget_hints(session);
+		session->row_count = session->dealing_map->row_count;
+		session->col_count = session->dealing_map->col_count;
+	}
+	session_cancel_deal(session);
+	return result;
+}
+
+double session_deal_progress(const game_session_t *session)
+{
+	return session->dealing != NULL ? generator_progress(session->dealing) : 0;
+}
+
+void session_cancel_deal(game_session_t *session)
+{
+	generator_free(session->dealing);
+	session->dealing = NULL;
+	session->dealing_map = NULL;
+}
+
+int session_restore(
+	game_session_t *session, int row_count, int col_count,
+	const position_t *positions, const chip_t *chips, int count,
+	const position_t *undo_positions, const chip_t *undo_chips, int undo_count)
+{
+	int i;
+	int result;
+	position_t *all;
+	unsigned char *blocker;
+
+	if(undo_count % 2 || undo_count > MAX_CHIP_COUNT)
+		return 0;
+
+	all = (position_t *) malloc(sizeof(position_t) * (count + undo_count + 1));
+	blocker = (unsigned char *) malloc(count + undo_count + 1);
+
+	/* The layout consists of the remaining and the removed chips */
+	for(i = 0; i < count; ++i) {
+		all[i] = positions[i];
+		blocker[i] = (chips[i] & CHIP_CATEGORY_MASK) == CHIP_CATEGORY_BLOCK;
+	}
+	for(i = 0; i < undo_count; ++i) {
+		all[count + i] = undo_positions[i];
+		blocker[count + i] = 0;
+	}
+
+	layout_free(&session->saved_layout);
+	result = layout_build(&session->saved_layout, all, blocker, count + undo_count);
+	free(all);
+	free(blocker);
+	if(!result)
+		return 0;
+
+	board_init(&session->board, &session->saved_layout);
+	for(i = 0; i < count; ++i)
+		board_set(&session->board, &positions[i], chips[i]);
+	/* Removed chips keep their value in the slot */
+	for(i = 0; i < undo_count; ++i) {
+		board_set(&session->board, &undo_positions[i], undo_chips[i]);
+		board_set(&session->board, &undo_positions[i], 0);
+	}
+	board_init_free_set(&session->board);
+
+	session->row_count = row_count;
+	session->col_count = col_count;
+	session->undo_count = undo_count / 2;
+	for(i = 0; i < session->undo_count; ++i) {
+		session->undo[i].slot1 = layout_find(&session->saved_layout, &undo_positions[2 * i]);
+		session->undo[i].slot2 = layout_find(&session->saved_layout, &undo_positions[2 * i + 1]);
+	}
+	forget_hints(session);
+	memset(&session->deal_id, 0, sizeof(deal_id_t));
+	return 1;
+}
+
+int session_apply_move(game_session_t *session, int slot1, int slot2)
+{
+	board_t *board = &session->board;
+
+	if(slot1 == slot2)
+		return 0;
+	if(free_set_index(&board->free, slot1) < 0 || free_set_index(&board->free, slot2) < 0)
+		return 0;
+	if(!fits(board_chip(board, slot1), board_chip(board, slot2)))
+		return 0;
+
+	board_remove_chip(board, slot1);
+	board_remove_chip(board, slot2);
+	session->undo[session->undo_count].slot1 = slot1;
+	session->undo[session->undo_count].slot2 = slot2;
+	++session->undo_count;
+	forget_hints(session);
+	return 1;
+}
+
+int session_undo(game_session_t *session)
+{
+	const move_t *move;
+
+	if(session->undo_count == 0)
+		return 0;
+
+	--session->undo_count;
+	move = &session->undo[session->undo_count];
+	board_restore_chip(&session->board, move->slot2, session->board.chip[move->slot2]);
+	board_restore_chip(&session->board, move->slot1, session->board.chip[move->slot1]);
+	forget_hints(session);
+	return 1;
+}
+
+int session_reshuffle(game_session_t *session)
+{
+	if(!reshuffle_board(&session->board, rng_next(&session->rng), NULL, &session->generator_stats))
+		return 0;
+	/* Putting pairs back among the moved chips would make a position that was never dealt */
+	session->undo_count = 0;
+	memset(&session->deal_id, 0, sizeof(deal_id_t));
+	forget_hints(session);
+	return 1;
+}
+
+session_status_t session_status(const game_session_t *session)
+{
+	if(session->board.tile_count == 0)
+		return SESSION_WON;
+	if(session->board.free_pair_count == 0)
+		return SESSION_STUCK;
+	if(board_deadlocked(&session->board))
+		return SESSION_LOST;
+	return SESSION_PLAYING;
+}
+
+int session_hint(game_session_t *session, move_t *move)
+{
+	if(!session->hints.ready)
+		hint_rank(&session->hints, &session->board);
+	if(session->hints.count == 0)
+		return 0;
+	if(session->hint_index >= session->hints.count)
+		session->hint_index = 0;
+
+	*move = session->hints.hint[session->hint_index].move;
+	++session->hint_index;
+	return 1;
+}
+
+int session_prepare_hints(game_session_t *session, double slice)
+{
+	/* Re-ranking while the player goes through the list would repeat and skip moves */
+	if(session->board.layout == NULL || session->hint_index > 0)
+		return 0;
+	return hint_look_ahead(&session->hints, &session->board, slice);
+}
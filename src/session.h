@@ -0,0 +1,99 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "board.h"
+#include "common.h"
+#include "hint.h"
+#include "layout.h"
+
+/*
+	One game with its board and undo log. Sessions share nothing but the
+	read-only map layouts, so independent games can be played in parallel
+	threads as long as map_layout() has been called once for each map
+	beforehand.
+*/
+typedef struct {
+	board_t board;
+	layout_t saved_layout; /* Layout of a restored game, which has no map */
+	int row_count;
+	int col_count;
+	move_t undo[MAX_CHIP_COUNT / 2]; /* Removed chips stay on the board, so the slots suffice */
+	int undo_count;
+	int hint_index; /* Next move to suggest */
+	hint_list_t hints; /* Ranked moves of the current position */
+	generator_stats_t generator_stats; /* Of the last deal */
+	deal_id_t deal_id; /* Of the current game, all zero for restored games */
+	rng_t rng; /* Seeds of new deals */
+	int generator_threads; /* Searches raced for a new deal */
+	int difficulty; /* Of new deals, see generate_board() */
+	generator_t *dealing; /* Deal in progress, see session_start_deal() */
+	map_t *dealing_map;
+} game_session_t;
+
+typedef enum {
+	SESSION_PLAYING,
+	SESSION_WON,
+	SESSION_STUCK, /* No moves left */
+	SESSION_LOST /* Moves left, but board_deadlocked() says the game can't be won */
+} session_status_t;
+
+game_session_t *session_create(void);
+void session_destroy(game_session_t *session);
+/* New sessions always deal the same games until seeded */
+void session_seed(game_session_t *session, uint64_t seed);
+
+/* Deals a new game, returns 0 on invalid maps or if no deal was found in time */
+int session_new_game(game_session_t *session, map_t *map);
+
+/* Starts a new game on a normal deal made beforehand for the map from seed */
+void session_use_deal(game_session_t *session, map_t *map, const board_t *deal, uint32_t seed);
+
+/* Starts the game named by the ID, returns 0 if it is for another map */
+int session_replay_deal(game_session_t *session, map_t *map, const deal_id_t *id);
+
+/*
+	Deals a new game in steps of about slice seconds, so a single threaded
+	caller can keep its interface going in between. session_continue_deal()
+	returns GENERATOR_RUNNING until done, then 1 if the game is ready and 0
+	if no deal was found. The current game stays as it is until then.
+*/
+int session_start_deal(game_session_t *session, map_t *map);
+int session_continue_deal(game_session_t *session, double slice);
+double session_deal_progress(const game_session_t *session);
+void session_cancel_deal(game_session_t *session);
+
+/*
+	Sets up a saved game from the chips on the board and the removed chips
+	in the order they were taken, returns 0 if they don't make up a layout.
+*/
+int session_restore(
+	game_session_t *session, int row_count, int col_count,
+	const position_t *positions, const chip_t *chips, int count,
+	const position_t *undo_positions, const chip_t *undo_chips, int undo_count);
+
+/* Removes two free fitting chips, returns 0 if that is not a legal move */
+int session_apply_move(game_session_t *session, int slot1, int slot2);
+/* Puts the last pair back, returns 0 if there is nothing to undo */
+int session_undo(game_session_t *session);
+
+session_status_t session_status(const game_session_t *session);
+
+/*
+	Deals the remaining chips anew so the game can be finished, returns 0
+	if that failed. The moves before can't be taken back any more and the
+	board is no longer the one of the deal ID, so both are forgotten.
+*/
+int session_reshuffle(game_session_t *session);
+
+/*
+	Suggests the legal moves one after the other, best first, returns 0 if
+	there are none. The moves are ranked when they are first asked for
+	unless session_prepare_hints() did it already. Once the first move was
+	suggested the order stays as it is until the position changes, so
+	going through the list never repeats or skips a move.
+*/
+int session_hint(game_session_t *session, move_t *move);
+/* Ranks the moves for about slice seconds, returns 0 once they are all ranked or being suggested */
+int session_prepare_hints(game_session_t *session, double slice);
+
+#endif
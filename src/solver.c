@@ -0,0 +1,726 @@
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "solver.h"
+#include "common.h"
+#include "layout.h"
+
+/*
+	A lost position, key is the Zobrist hash with the lowest bit set so
+	that 0 means empty. Threads share the table without locks: a writer
+	clears the key before changing the rest and sets it last, and a reader
+	only believes an entry whose key was the same before and after it
+	compared the state.
+*/
+typedef struct {
+	uint64_t key;
+	int tile_count; /* Left on the board, larger ones took more work to prove */
+	board_state_t state;
+} solver_entry_t;
+
+typedef struct search_pool search_pool_t;
+
+/*
+	Position whose moves were searched by more than one thread, made for
+	the root of every task and for the positions on the way down to where
+	a thread handed moves on. It is lost once all of these searches came
+	out lost, then it goes into the table and counts towards its parent.
+*/
+typedef struct task_record task_record_t;
+
+struct task_record {
+	task_record_t *parent; /* NULL for the whole board */
+	task_record_t *next; /* Of the records made by the same thread, to free them */
+	int count; /* Searches not finished yet, the local one included */
+	uint64_t hash;
+	int tile_count;
+	board_state_t state;
+};
+
+/* Subtree handed from one thread to another */
+typedef struct {
+	move_t line[MAX_CHIP_COUNT / 2]; /* Moves from the root */
+	int depth;
+	task_record_t *parent;
+} task_t;
+
+/* One thread's search, the single threaded one included */
+typedef struct {
+	const solver_t *solver;
+	search_pool_t *pool; /* NULL when searching alone */
+	board_t board;
+	uint64_t hash;
+	unsigned char class_left[CHIP_CLASS_COUNT]; /* Chips of each class still on the board */
+	move_t line[MAX_CHIP_COUNT / 2];
+	move_t *moves; /* Moves of all levels of the search, one after the other */
+	int move_top;
+	int move_capacity;
+	long node_limit;
+	double deadline;
+	const int *cancel;
+	int out_of_budget;
+	solver_stats_t stats;
+
+	task_record_t *record[MAX_CHIP_COUNT / 2 + 1]; /* Per depth, where there is one */
+	task_record_t *records;
+
+	/* Tasks of this thread, it takes the newest and others steal the oldest */
+	pthread_mutex_t lock;
+	task_t *tasks;
+	int task_first;
+	int task_end;
+	int task_capacity;
+} worker_t;
+
+struct search_pool {
+	const board_t *root;
+	uint64_t root_hash;
+	unsigned char root_class_left[CHIP_CLASS_COUNT];
+	worker_t *workers;
+	int thread_count;
+	int pending; /* Tasks handed out and not finished yet */
+	int idle; /* Threads looking for a task */
+	int stop;
+	int found;
+	long nodes; /* Of all threads, added up in batches */
+	long node_limit;
+	double deadline;
+	const int *cancel;
+	int out_of_budget;
+	move_t line[MAX_CHIP_COUNT / 2];
+};
+
+struct solver {
+	uint64_t zobrist[MAX_SLOT_COUNT]; /* Per removed slot */
+	solver_entry_t *table; /* Buckets of two, the first keeps the larger position */
+	uint64_t table_mask;
+
+	/* Deal the table is valid for */
+	const layout_t *layout;
+	chip_t chip[MAX_SLOT_COUNT];
+
+	worker_t worker;
+};
+
+/* Result of a search that handed some of its moves to other threads, so it proved nothing */
+#define HANDED_OFF 2
+/* Smaller subtrees are not worth handing over */
+#define HAND_OFF_MIN_TILES 24
+#define NODE_BATCH 256
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+solver_t *solver_create(int table_bits)
+{
+	int i;
+	rng_t rng;
+	solver_t *solver;
+
+	if(table_bits < 1 || table_bits > 30)
+		return NULL;
+	solver = (solver_t *) calloc(1, sizeof(solver_t));
+	if(solver == NULL)
+		return NULL;
+	solver->table = (solver_entry_t *) calloc((size_t) 1 << table_bits, sizeof(solver_entry_t));
+	if(solver->table == NULL) {
+		free(solver);
+		return NULL;
+	}
+	solver->table_mask = ((uint64_t) 1 << table_bits) - 1;
+	solver->worker.solver = solver;
+
+	/* The keys are the same on every run, so are the table collisions */
+	rng_seed(&rng, 0x5eed);
+	for(i = 0; i < MAX_SLOT_COUNT; ++i)
+		solver->zobrist[i] = (uint64_t) rng_next(&rng) << 32 | rng_next(&rng);
+	return solver;
+}
+
+void solver_free(solver_t *solver)
+{
+	if(solver == NULL)
+		return;
+	free(solver->table);
+	free(solver->worker.moves);
+	free(solver);
+}
+
+static solver_entry_t *table_bucket(const solver_t *solver, uint64_t hash)
+{
+	return &solver->table[hash & solver->table_mask & ~(uint64_t) 1];
+}
+
+static int entry_matches(solver_entry_t *entry, uint64_t key, const board_state_t *state)
+{
+	int k;
+
+	if(__atomic_load_n(&entry->key, __ATOMIC_ACQUIRE) != key)
+		return 0;
+	for(k = 0; k < SLOT_WORDS; ++k)
+		if(__atomic_load_n(&entry->state.removed[k], __ATOMIC_RELAXED) != state->removed[k])
+			return 0;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&entry->key, __ATOMIC_RELAXED) == key;
+}
+
+static int table_find(const worker_t *w)
+{
+	solver_entry_t *bucket = table_bucket(w->solver, w->hash);
+	const uint64_t key = w->hash | 1;
+
+	return entry_matches(&bucket[0], key, &w->board.state) || entry_matches(&bucket[1], key, &w->board.state);
+}
+
+static void table_store(const solver_t *solver, uint64_t hash, const board_state_t *state, int tile_count)
+{
+	int k;
+	solver_entry_t *bucket = table_bucket(solver, hash);
+	solver_entry_t *entry = &bucket[1];
+
+	if(__atomic_load_n(&bucket[0].key, __ATOMIC_RELAXED) == 0 || tile_count >= __atomic_load_n(&bucket[0].tile_count, __ATOMIC_RELAXED))
+		entry = &bucket[0];
+	__atomic_store_n(&entry->key, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&entry->tile_count, tile_count, __ATOMIC_RELAXED);
+	for(k = 0; k < SLOT_WORDS; ++k)
+		__atomic_store_n(&entry->state.removed[k], state->removed[k], __ATOMIC_RELAXED);
+	__atomic_store_n(&entry->key, hash | 1, __ATOMIC_RELEASE);
+}
+
+static int cancelled(const int *cancel)
+{
+	return cancel != NULL && __atomic_load_n(cancel, __ATOMIC_RELAXED);
+}
+
+static int budget_over(worker_t *w)
+{
+	search_pool_t *pool = w->pool;
+
+	++w->stats.nodes;
+	if(pool == NULL) {
+		if(w->node_limit && w->stats.nodes > w->node_limit)
+			return 1;
+		/* Looking at the clock is comparatively expensive */
+		return w->stats.nodes % 256 == 0 && ((w->deadline && now() > w->deadline) || cancelled(w->cancel));
+	}
+
+	if(w->stats.nodes % NODE_BATCH == 0) {
+		const long nodes = __atomic_add_fetch(&pool->nodes, NODE_BATCH, __ATOMIC_RELAXED);
+		if((pool->node_limit && nodes > pool->node_limit) || (pool->deadline && now() > pool->deadline) || cancelled(pool->cancel)) {
+			__atomic_store_n(&pool->out_of_budget, 1, __ATOMIC_RELAXED);
+			__atomic_store_n(&pool->stop, 1, __ATOMIC_RELAXED);
+		}
+	}
+	return __atomic_load_n(&pool->stop, __ATOMIC_RELAXED);
+}
+
+/* Chips lying on many others first, they are the ones most likely in the way */
+static int move_weight(const worker_t *w, const move_t *move)
+{
+	const layout_t *layout = w->board.layout;
+	const int c = w->board.chip_class[move->slot1];
+
+	return 256 * w->class_left[c]
+		- (layout->below_start[move->slot1 + 1] - layout->below_start[move->slot1])
+		- (layout->below_start[move->slot2 + 1] - layout->below_start[move->slot2]);
+}
+
+/* Sorts the moves by weight keeping the order of equal ones, returns how many are worth trying */
+static int order_moves(const worker_t *w, move_t *moves, int count)
+{
+	int i, j;
+	int weight[MAX_MOVE_COUNT];
+	const board_t *board = &w->board;
+
+	for(i = 0; i < count; ++i) {
+		const int c = board->chip_class[moves[i].slot1];
+		if(w->class_left[c] == board->free_class_count[c]) {
+			moves[0] = moves[i];
+			return 1;
+		}
+	}
+
+	for(i = 0; i < count; ++i) {
+		const move_t move = moves[i];
+		const int weight_i = move_weight(w, &move);
+
+		for(j = i; j > 0 && weight[j - 1] > weight_i; --j) {
+			moves[j] = moves[j - 1];
+			weight[j] = weight[j - 1];
+		}
+		moves[j] = move;
+		weight[j] = weight_i;
+	}
+	return count;
+}
+
+static void take(worker_t *w, const move_t *move)
+{
+	board_t *board = &w->board;
+
+	w->class_left[board->chip_class[move->slot1]] -= 2;
+	w->hash ^= w->solver->zobrist[move->slot1] ^ w->solver->zobrist[move->slot2];
+	board_remove_chip(board, move->slot1);
+	board_remove_chip(board, move->slot2);
+}
+
+static void put_back(worker_t *w, const move_t *move)
+{
+	board_t *board = &w->board;
+
+	board_restore_chip(board, move->slot2, board->chip[move->slot2]);
+	board_restore_chip(board, move->slot1, board->chip[move->slot1]);
+	w->hash ^= w->solver->zobrist[move->slot1] ^ w->solver->zobrist[move->slot2];
+	w->class_left[board->chip_class[move->slot1]] += 2;
+}
+
+static int reserve_moves(worker_t *w, int count)
+{
+	move_t *moves;
+	int capacity = w->move_capacity ? w->move_capacity : 1024;
+
+	if(w->move_top + count <= w->move_capacity)
+		return 1;
+	while(capacity < w->move_top + count)
+		capacity *= 2;
+	moves = (move_t *) realloc(w->moves, sizeof(move_t) * capacity);
+	if(moves == NULL)
+		return 0;
+	w->moves = moves;
+	w->move_capacity = capacity;
+	return 1;
+}
+
+/* Hands moves to threads that ran out of work, only while this thread has none queued */
+static int wants_hand_off(worker_t *w)
+{
+	int empty;
+
+	if(w->pool == NULL || w->board.tile_count < HAND_OFF_MIN_TILES || !__atomic_load_n(&w->pool->idle, __ATOMIC_RELAXED))
+		return 0;
+	pthread_mutex_lock(&w->lock);
+	empty = w->task_first == w->task_end;
+	pthread_mutex_unlock(&w->lock);
+	return empty;
+}
+
+static task_record_t *new_record(worker_t *w, task_record_t *parent, uint64_t hash, const board_state_t *state, int tile_count)
+{
+	task_record_t *record = (task_record_t *) malloc(sizeof(task_record_t));
+
+	if(record == NULL)
+		return NULL;
+	record->parent = parent;
+	record->next = w->records;
+	record->count = 1;
+	record->hash = hash;
+	record->tile_count = tile_count;
+	record->state = *state;
+	w->records = record;
+	if(parent != NULL)
+		__atomic_add_fetch(&parent->count, 1, __ATOMIC_RELAXED);
+	return record;
+}
+
+/* Makes the records from the deepest position that has one down to depth */
+static int make_records(worker_t *w, int depth)
+{
+	int d = depth;
+
+	while(w->record[d] == NULL)
+		--d;
+	for(++d; d <= depth; ++d) {
+		int k;
+		uint64_t hash = w->hash;
+		board_state_t state = w->board.state;
+
+		/* The position at d is the current one with the moves from there on put back */
+		for(k = d; k < depth; ++k) {
+			const int slot1 = w->line[k].slot1;
+			const int slot2 = w->line[k].slot2;
+
+			hash ^= w->solver->zobrist[slot1] ^ w->solver->zobrist[slot2];
+			state.removed[slot1 / 32] &= ~(1u << (slot1 % 32));
+			state.removed[slot2 / 32] &= ~(1u << (slot2 % 32));
+		}
+		w->record[d] = new_record(w, w->record[d - 1], hash, &state, w->board.tile_count + 2 * (depth - d));
+		if(w->record[d] == NULL)
+			return 0;
+	}
+	return 1;
+}
+
+/* Queues the subtrees after the given moves of the position at depth */
+static int hand_off(worker_t *w, int depth, const move_t *moves, int count)
+{
+	int i;
+
+	if(!make_records(w, depth))
+		return 0;
+	pthread_mutex_lock(&w->lock);
+	if(w->task_end + count > w->task_capacity) {
+		int capacity = w->task_capacity ? w->task_capacity : 64;
+		task_t *tasks;
+
+		/* Make room at the front first */
+		if(w->task_first > 0)
+			memmove(w->tasks, w->tasks + w->task_first, sizeof(task_t) * (w->task_end - w->task_first));
+		w->task_end -= w->task_first;
+		w->task_first = 0;
+		while(capacity < w->task_end + count)
+			capacity *= 2;
+		tasks = capacity > w->task_capacity ? (task_t *) realloc(w->tasks, sizeof(task_t) * capacity) : w->tasks;
+		if(tasks == NULL) {
+			pthread_mutex_unlock(&w->lock);
+			return 0;
+		}
+		w->tasks = tasks;
+		w->task_capacity = capacity;
+	}
+	for(i = 0; i < count; ++i) {
+		task_t *task = &w->tasks[w->task_end++];
+		memcpy(task->line, w->line, sizeof(move_t) * depth);
+		task->line[depth] = moves[i];
+		task->depth = depth + 1;
+		task->parent = w->record[depth];
+	}
+	__atomic_add_fetch(&w->record[depth]->count, count, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&w->pool->pending, count, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&w->lock);
+	w->stats.tasks += count;
+	return 1;
+}
+
+/* One of the searches of the position ended lost, so may the position and those above it */
+static void finish_record(const solver_t *solver, task_record_t *record)
+{
+	while(record != NULL && __atomic_sub_fetch(&record->count, 1, __ATOMIC_ACQ_REL) == 0) {
+		table_store(solver, record->hash, &record->state, record->tile_count);
+		record = record->parent;
+	}
+}
+
+static int search(worker_t *w, int depth)
+{
+	int i, count;
+	int result = 0;
+	board_t *board = &w->board;
+	const int base = w->move_top;
+
+	if(board->tile_count == 0)
+		return 1;
+	if(board->free_pair_count == 0)
+		return 0;
+	if(table_find(w)) {
+		++w->stats.table_hits;
+		return 0;
+	}
+	/* Positions further down were reached from one that wasn't deadlocked, so the last move is all there is to check */
+	if(depth > 0 ? board_deadlocked_by(board, &w->line[depth - 1]) : board_deadlocked(board)) {
+		++w->stats.deadlocks;
+		return 0;
+	}
+	if(budget_over(w) || !reserve_moves(w, board->free_pair_count)) {
+		w->out_of_budget = 1;
+		return SOLVER_UNKNOWN;
+	}
+
+	/* order_moves() weighs at most MAX_MOVE_COUNT of them */
+	count = board_moves(board, w->moves + base, board->free_pair_count < MAX_MOVE_COUNT ? board->free_pair_count : MAX_MOVE_COUNT);
+	count = order_moves(w, w->moves + base, count);
+	w->move_top += count;
+
+	/* The moves may be reallocated further down, so they are copied out */
+	for(i = 0; i < count; ++i) {
+		const move_t move = w->moves[base + i];
+		int last = 0;
+
+		/* Others get the moves after this one, starting near the root where the subtrees are largest */
+		if(i + 1 < count && wants_hand_off(w) && hand_off(w, depth, w->moves + base + i + 1, count - i - 1)) {
+			last = 1;
+		}
+
+		take(w, &move);
+		w->line[depth] = move;
+		result = search(w, depth + 1);
+		put_back(w, &move);
+
+		/* Its record counts towards the one of this position */
+		if(result == HANDED_OFF)
+			result = 0;
+		if(result != 0 || last)
+			break;
+	}
+
+	w->move_top = base;
+	if(w->pool != NULL && w->record[depth] != NULL) {
+		task_record_t *record = w->record[depth];
+
+		w->record[depth] = NULL;
+		if(result != 0)
+			return result;
+		finish_record(w->solver, record);
+		return HANDED_OFF;
+	}
+	if(result == 0)
+		table_store(w->solver, w->hash, &board->state, board->tile_count);
+	return result;
+}
+
+/* The table only holds for the chips it was filled with */
+static void use_deal(solver_t *solver, const board_t *board)
+{
+	const layout_t *layout = board->layout;
+
+	if(solver->layout == layout && !memcmp(solver->chip, board->chip, layout->slot_count))
+		return;
+	memset(solver->table, 0, sizeof(solver_entry_t) * (solver->table_mask + 1));
+	solver->layout = layout;
+	memcpy(solver->chip, board->chip, layout->slot_count);
+}
+
+static void start_search(worker_t *w, const board_t *board)
+{
+	int i;
+
+	w->board = *board;
+	w->hash = 0;
+	memset(w->class_left, 0, sizeof(w->class_left));
+	for(i = 0; i < board->layout->slot_count; ++i) {
+		if(board_removed(board, i))
+			w->hash ^= w->solver->zobrist[i];
+		else if(!board->layout->blocker[i])
+			++w->class_left[board->chip_class[i]];
+	}
+	w->move_top = 0;
+	w->out_of_budget = 0;
+}
+
+int solve_board(solver_t *solver, const board_t *board, const solver_limits_t *limits, move_t *line, solver_stats_t *stats)
+{
+	int result;
+	double start;
+	worker_t *w = &solver->worker;
+
+	use_deal(solver, board);
+	start = now();
+	start_search(w, board);
+	memset(&w->stats, 0, sizeof(solver_stats_t));
+	w->node_limit = limits ? limits->node_limit : 0;
+	w->deadline = limits && limits->time_limit ? start + limits->time_limit : 0;
+	w->cancel = limits ? limits->cancel : NULL;
+
+	result = search(w, 0);
+	if(w->out_of_budget && result != 1)
+		result = SOLVER_UNKNOWN;
+
+	w->stats.seconds = now() - start;
+	if(result == 1 && line != NULL)
+		memcpy(line, w->line, sizeof(move_t) * (board->tile_count / 2));
+	if(stats != NULL)
+		*stats = w->stats;
+	return result;
+}
+
+static int pop_task(worker_t *w, task_t *task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&w->lock);
+	if(w->task_first < w->task_end) {
+		*task = w->tasks[--w->task_end];
+		found = 1;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return found;
+}
+
+/* The oldest tasks are the largest subtrees */
+static int steal_task(worker_t *w, task_t *task)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&w->lock);
+	if(w->task_first < w->task_end) {
+		*task = w->tasks[w->task_first++];
+		found = 1;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return found;
+}
+
+static int find_task(worker_t *w, task_t *task)
+{
+	int i;
+	search_pool_t *pool = w->pool;
+	const int self = w - pool->workers;
+
+	if(pop_task(w, task))
+		return 1;
+	for(i = 1; i < pool->thread_count; ++i)
+		if(steal_task(&pool->workers[(self + i) % pool->thread_count], task))
+			return 1;
+	return 0;
+}
+
+static void run_task(worker_t *w, const task_t *task)
+{
+	int i, result;
+	search_pool_t *pool = w->pool;
+
+	w->board = *pool->root;
+	w->hash = pool->root_hash;
+	memcpy(w->class_left, pool->root_class_left, sizeof(w->class_left));
+	w->move_top = 0;
+	for(i = 0; i < task->depth; ++i) {
+		take(w, &task->line[i]);
+		w->line[i] = task->line[i];
+	}
+
+	/* The parent counted the task when it was handed over, the record takes that over */
+	w->record[task->depth] = new_record(w, task->parent, w->hash, &w->board.state, w->board.tile_count);
+	if(w->record[task->depth] == NULL) {
+		__atomic_store_n(&pool->out_of_budget, 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&pool->stop, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	if(task->parent != NULL)
+		__atomic_sub_fetch(&task->parent->count, 1, __ATOMIC_RELAXED);
+
+	result = search(w, task->depth);
+	if(result == 1 && !__atomic_exchange_n(&pool->found, 1, __ATOMIC_ACQ_REL)) {
+		memcpy(pool->line, w->line, sizeof(move_t) * (pool->root->tile_count / 2));
+		__atomic_store_n(&pool->stop, 1, __ATOMIC_RELAXED);
+	}
+
+	/* Searches that end before looking at any move leave the record to this */
+	if(w->record[task->depth] != NULL) {
+		task_record_t *record = w->record[task->depth];
+
+		w->record[task->depth] = NULL;
+		if(result == 0)
+			finish_record(w->solver, record);
+	}
+}
+
+static void *run_worker(void *arg)
+{
+	worker_t *w = (worker_t *) arg;
+	search_pool_t *pool = w->pool;
+	int idle = 0;
+	task_t *task = (task_t *) malloc(sizeof(task_t));
+
+	while(!__atomic_load_n(&pool->stop, __ATOMIC_RELAXED)) {
+		if(find_task(w, task)) {
+			if(idle) {
+				__atomic_sub_fetch(&pool->idle, 1, __ATOMIC_RELAXED);
+				idle = 0;
+			}
+			run_task(w, task);
+			__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELEASE);
+			continue;
+		}
+		if(!__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE))
+			break;
+		if(!idle) {
+			__atomic_add_fetch(&pool->idle, 1, __ATOMIC_RELAXED);
+			idle = 1;
+		}
+		sched_yield();
+	}
+	if(idle)
+		__atomic_sub_fetch(&pool->idle, 1, __ATOMIC_RELAXED);
+	free(task);
+	return NULL;
+}
+
+int solve_board_parallel(solver_t *solver, const board_t *board, int thread_count, const solver_limits_t *limits, move_t *line, solver_stats_t *stats)
+{
+	int i, result;
+	double start;
+	search_pool_t pool;
+	unsigned char started[SOLVER_MAX_THREADS];
+	worker_t *w;
+	pthread_t threads[SOLVER_MAX_THREADS];
+
+	if(thread_count <= 1)
+		return solve_board(solver, board, limits, line, stats);
+	if(thread_count > SOLVER_MAX_THREADS)
+		thread_count = SOLVER_MAX_THREADS;
+
+	use_deal(solver, board);
+	start = now();
+	memset(&pool, 0, sizeof(search_pool_t));
+	pool.root = board;
+	pool.thread_count = thread_count;
+	pool.node_limit = limits ? limits->node_limit : 0;
+	pool.deadline = limits && limits->time_limit ? start + limits->time_limit : 0;
+	pool.cancel = limits ? limits->cancel : NULL;
+	pool.workers = (worker_t *) calloc(thread_count, sizeof(worker_t));
+	if(pool.workers == NULL)
+		return solve_board(solver, board, limits, line, stats);
+
+	for(i = 0; i < thread_count; ++i) {
+		w = &pool.workers[i];
+		w->solver = solver;
+		w->pool = &pool;
+		pthread_mutex_init(&w->lock, NULL);
+	}
+	start_search(&pool.workers[0], board);
+	pool.root_hash = pool.workers[0].hash;
+	memcpy(pool.root_class_left, pool.workers[0].class_left, sizeof(pool.root_class_left));
+
+	/* The whole board is the first task */
+	w = &pool.workers[0];
+	w->tasks = (task_t *) malloc(sizeof(task_t));
+	if(w->tasks != NULL) {
+		w->task_capacity = 1;
+		w->task_end = 1;
+		w->tasks[0].depth = 0;
+		w->tasks[0].parent = NULL;
+		pool.pending = 1;
+	}
+
+	for(i = 1; i < thread_count; ++i)
+		started[i] = pthread_create(&threads[i], NULL, run_worker, &pool.workers[i]) == 0;
+	/* The calling thread searches as well */
+	run_worker(&pool.workers[0]);
+	for(i = 1; i < thread_count; ++i)
+		if(started[i])
+			pthread_join(threads[i], NULL);
+
+	result = pool.found ? 1 : pool.out_of_budget || w->tasks == NULL ? SOLVER_UNKNOWN : 0;
+	if(result == 1 && line != NULL)
+		memcpy(line, pool.line, sizeof(move_t) * (board->tile_count / 2));
+	if(stats != NULL) {
+		memset(stats, 0, sizeof(solver_stats_t));
+		for(i = 0; i < thread_count; ++i) {
+			stats->nodes += pool.workers[i].stats.nodes;
+			stats->table_hits += pool.workers[i].stats.table_hits;
+			stats->deadlocks += pool.workers[i].stats.deadlocks;
+			stats->tasks += pool.workers[i].stats.tasks;
+		}
+		stats->seconds = now() - start;
+	}
+
+	for(i = 0; i < thread_count; ++i) {
+		task_record_t *record = pool.workers[i].records;
+
+		while(record != NULL) {
+			task_record_t *next = record->next;
+			free(record);
+			record = next;
+		}
+		free(pool.workers[i].moves);
+		free(pool.workers[i].tasks);
+		pthread_mutex_destroy(&pool.workers[i].lock);
+	}
+	free(pool.workers);
+	return result;
+}
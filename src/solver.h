@@ -0,0 +1,63 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "board.h"
+
+/*
+	Exact depth-first search for a way to clear a board. Positions are
+	keyed by the bitset of removed slots and looked up by a Zobrist hash
+	that is updated with every move taken or put back. Positions that were
+	proven lost go into a transposition table of fixed size, which is kept
+	between calls as long as the deal stays the same, so solving the
+	positions of one game one after the other gets cheaper as it goes.
+
+	When all remaining chips of a class are free, taking two of them can't
+	hurt, so that is the only move tried. Otherwise the classes with the
+	fewest chips left come first, and within a class the chips covering
+	the most others.
+*/
+typedef struct solver solver_t;
+
+/* The table holds 2^table_bits positions of about 80 bytes each */
+#define SOLVER_DEFAULT_TABLE_BITS 16
+
+solver_t *solver_create(int table_bits);
+void solver_free(solver_t *solver);
+
+typedef struct {
+	long node_limit; /* Positions searched, 0 for no limit */
+	double time_limit; /* Seconds, 0 for no limit */
+	const int *cancel; /* Set by another thread to stop the search, may be NULL */
+} solver_limits_t;
+
+typedef struct {
+	long nodes; /* Positions searched */
+	long table_hits; /* Positions found lost in the table */
+	long deadlocks; /* Positions found lost by board_deadlocked() */
+	long tasks; /* Subtrees handed to other threads */
+	double seconds;
+} solver_stats_t;
+
+#define SOLVER_UNKNOWN (-1)
+
+/*
+	Returns 1 if the board can be cleared, 0 if it can't and SOLVER_UNKNOWN
+	if the limits ran out first. On success line holds the tile_count / 2
+	moves of a winning line, it may be NULL. limits and stats may be NULL.
+*/
+int solve_board(solver_t *solver, const board_t *board, const solver_limits_t *limits, move_t *line, solver_stats_t *stats);
+
+#define SOLVER_MAX_THREADS 64
+
+/*
+	The same search on thread_count threads, the calling one included.
+	Each thread has a queue of subtrees: it works on the newest of its own
+	and when it runs out takes the oldest of another thread's, and a thread
+	that sees others waiting hands them the moves of its position that it
+	hasn't tried yet. All threads share the solver's table. The node limit
+	counts the positions of all threads. Which winning line is found
+	depends on the timing.
+*/
+int solve_board_parallel(solver_t *solver, const board_t *board, int thread_count, const solver_limits_t *limits, move_t *line, solver_stats_t *stats);
+
+#endif
@@ -0,0 +1,327 @@
+#include <string.h>
+#include "storage.h"
+#include "common.h"
+#include "layout.h"
+
+/* Returns 1 on success, 0 on invalid positions and -1 at the end of the file */
+static int read_position(FILE *f, const map_t *map, position_t *pos)
+{
+	int x = 0, y = 0, z = 0;
+
+	if(fscanf(f, "%d %d %d\n", &x, &y, &z) == EOF)
+		return -1;
+	if(
+		x < 0 || x >= map->col_count ||
+		y < 0 || y >= map->row_count ||
+		z < 0 || z >= MAX_HEIGHT)
+		return 0;
+
+	pos->x = (unsigned char) x;
+	pos->y = (unsigned char) y;
+	pos->z = (unsigned char) z;
+	return 1;
+}
+
+int map_read(map_t *map, FILE *f)
+{
+	unsigned int chip;
+	int result;
+	position_t pos;
+	char line[64];
+
+	/* Board size and the number of chips, a full set unless given */
+	int col_count = 32;
+	int row_count = 18;
+	int chip_count = CHIP_COUNT;
+	if(
+		fgets(line, sizeof(line), f) == NULL ||
+		sscanf(line, "%d %d %d", &col_count, &row_count, &chip_count) < 2 ||
+		col_count < 0 || col_count >= MAX_COL_COUNT ||
+		row_count < 0 || row_count >= MAX_ROW_COUNT ||
+		chip_count <= 0 || chip_count % PILE_STEP || chip_count > MAX_CHIP_COUNT)
+		return 0;
+	map->col_count = (unsigned char) col_count;
+	map->row_count = (unsigned char) row_count;
+	map->chip_count = chip_count;
+	map->chip = (position_t *) realloc(map->chip, sizeof(position_t) * chip_count);
+
+	/* Chip positions */
+	for(chip = 0; chip < map->chip_count; ++chip) {
+		if(read_position(f, map, &map->chip[chip]) != 1)
+			return 0;
+	}
+
+	/* All following positions are blocker positions */
+	while((result = read_position(f, map, &pos)) == 1) {
+		const unsigned int block = map->block_count;
+		++map->block_count;
+		map->block = (position_t *) realloc(map->block, sizeof(position_t) * map->block_count);
+		map->block[block] = pos;
+	}
+
+	return result == -1;
+}
+
+void map_write(const map_t *map, FILE *f)
+{
+	unsigned int i;
+
+	if(map->chip_count == CHIP_COUNT)
+		fprintf(f, "%d %d\n", map->col_count, map->row_count);
+	else
+		fprintf(f, "%d %d %u\n", map->col_count, map->row_count, map->chip_count);
+	for(i = 0; i < map->chip_count; ++i)
+		fprintf(f, "%d %d %d\n", map->chip[i].x, map->chip[i].y, map->chip[i].z);
+	for(i = 0; i < map->block_count; ++i)
+		fprintf(f, "%d %d %d\n", map->block[i].x, map->block[i].y, map->block[i].z);
+}
+
+void map_free(map_t *map)
+{
+	free(map->chip);
+	map->chip = NULL;
+	map->chip_count = 0;
+	free(map->block);
+	map->block = NULL;
+	map->block_count = 0;
+	if(map->layout != NULL) {
+		layout_free(map->layout);
+		free(map->layout);
+		map->layout = NULL;
+	}
+}
+
+/* The grid of every cell of the board, as saved before boards were stored per slot */
+static int read_grid(FILE *f, position_t *positions, chip_t *chips, int *count)
+{
+	int i, j, k;
+
+	for(i = 0; i < MAX_ROW_COUNT; ++i) {
+		for(j = 0; j < MAX_COL_COUNT; ++j) {
+			for(k = 0; k < MAX_HEIGHT; ++k) {
+				int chip;
+
+				if(fscanf(f, "%d\n", &chip) != 1)
+					return 0;
+
+				if(chip) {
+					if(*count == MAX_SLOT_COUNT)
+						return 0;
+					positions[*count].y = i;
+					positions[*count].x = j;
+					positions[*count].z = k;
+					chips[*count] = (chip_t) chip;
+					++*count;
+				}
+			}
+		}
+	}
+	return 1;
+}
+
+/* Reads count "y x z chip" lines */
+static int read_chips(FILE *f, position_t *positions, chip_t *chips, int count)
+{
+	int i;
+
+	for(i = 0; i < count; ++i) {
+		int chip, x, y, z;
+		if(fscanf(
+			f, "%d %d %d %d\n",
+			&y,
+			&x,
+			&z,
+			&chip) != 4)
+			return 0;
+		if(x < 0 || x >= MAX_COL_COUNT || y < 0 || y >= MAX_ROW_COUNT || z < 0 || z >= MAX_HEIGHT)
+			return 0;
+		positions[i].y = (unsigned char) y;
+		positions[i].x = (unsigned char) x;
+		positions[i].z = (unsigned char) z;
+		chips[i] = (chip_t) chip;
+	}
+	return 1;
+}
+
+/*
+	No chip may occur more often than in the largest pile, the removed ones
+	in the undo list included. A game saved after a reshuffle no longer
+	holds its whole pile, so the counts can't be matched exactly like
+	full_pile() does. The bound keeps every class within MAX_CLASS_SIZE,
+	which the move lists are sized by.
+*/
+static int valid_chips(const chip_t *chips, int chip_count, const chip_t *undo_chips, int undo_count)
+{
+	int i;
+	int count[256] = { 0 };
+
+	for(i = 0; i < chip_count; ++i)
+		if((chips[i] & CHIP_CATEGORY_MASK) != CHIP_CATEGORY_BLOCK)
+			++count[chips[i]];
+	for(i = 0; i < undo_count; ++i)
+		++count[undo_chips[i]];
+	for(i = 0; i < 256; ++i)
+		if(count[i] > pile_count((chip_t) i, MAX_CHIP_COUNT))
+			return 0;
+	return 1;
+}
+
+int session_read(game_session_t *session, FILE *f)
+{
+	int count = 0;
+	int row_count, col_count;
+	int undo_count;
+	char line[64];
+	position_t positions[MAX_SLOT_COUNT];
+	chip_t chips[MAX_SLOT_COUNT];
+	position_t undo_positions[MAX_CHIP_COUNT];
+	chip_t undo_chips[MAX_CHIP_COUNT];
+
+	if(fgets(line, sizeof(line), f) == NULL)
+		return 0;
+
+	switch(sscanf(line, "%d %d %d", &row_count, &col_count, &count)) {
+		case 2:
+			if(!read_grid(f, positions, chips, &count))
+				return 0;
+			break;
+		case 3:
+			if(count < 0 || count > MAX_SLOT_COUNT || !read_chips(f, positions, chips, count))
+				return 0;
+			break;
+		default:
+			return 0;
+	}
+
+	if(fscanf(f, "%d\n", &undo_count) != 1 || undo_count < 0 || undo_count > MAX_CHIP_COUNT)
+		return 0;
+	if(!read_chips(f, undo_positions, undo_chips, undo_count))
+		return 0;
+	if(!valid_chips(chips, count, undo_chips, undo_count))
+		return 0;
+
+	return session_restore(
+		session, row_count, col_count,
+		positions, chips, count,
+		undo_positions, undo_chips, undo_count);
+}
+
+void session_write(const game_session_t *session, FILE *f)
+{
+	int i;
+	const board_t *board = &session->board;
+	const layout_t *layout = board->layout;
+
+	fprintf(f, "%d %d %d\n", session->row_count, session->col_count, board->chip_count);
+
+	for(i = 0; i < layout->slot_count; ++i) {
+		if(board_removed(board, i))
+			continue;
+		fprintf(
+			f, "%d %d %d %d\n",
+			layout->y[i],
+			layout->x[i],
+			layout->z[i],
+			board->chip[i]);
+	}
+
+	fprintf(f, "%d\n", 2 * session->undo_count);
+	for(i = 0; i < 2 * session->undo_count; ++i) {
+		const int slot = i % 2 ? session->undo[i / 2].slot2 : session->undo[i / 2].slot1;
+		const position_t pos = layout_position(layout, slot);
+		fprintf(
+			f, "%d %d %d %d\n",
+			pos.y,
+			pos.x,
+			pos.z,
+			board->chip[slot]);
+	}
+}
+
+/* Every chip as often as in a pile for the layout and blockers only where they belong */
+static int full_pile(const board_t *board)
+{
+	int i;
+	int tile_count = 0;
+	int count[256] = { 0 };
+	const layout_t *layout = board->layout;
+
+	for(i = 0; i < layout->slot_count; ++i) {
+		const chip_t chip = board->chip[i];
+		if(layout->blocker[i] != ((chip & CHIP_CATEGORY_MASK) == CHIP_CATEGORY_BLOCK))
+			return 0;
+		if(!layout->blocker[i]) {
+			++count[chip];
+			++tile_count;
+		}
+	}
+	for(i = 0; i < 256; ++i)
+		if(count[i] != pile_count((chip_t) i, tile_count))
+			return 0;
+	return 1;
+}
+
+int deal_pool_read(deal_pool_t *pool, FILE *f)
+{
+	unsigned int hash, seed;
+	int slot_count;
+	int result = 0;
+	board_t *board = (board_t *) malloc(sizeof(board_t));
+
+	while(fscanf(f, "%u %u %d", &hash, &seed, &slot_count) == 3) {
+		int i;
+		int entry = -1;
+		const layout_t *layout = NULL;
+
+		if(slot_count < 0 || slot_count > MAX_SLOT_COUNT)
+			break;
+
+		pthread_mutex_lock(&pool->mutex);
+		for(i = 0; i < pool->entry_count; ++i)
+			if(pool->entry[i].hash == hash)
+				entry = i;
+		if(entry >= 0 && pool->entry[entry].map.layout->slot_count == slot_count)
+			layout = pool->entry[entry].map.layout;
+		pthread_mutex_unlock(&pool->mutex);
+
+		board_init(board, layout);
+		for(i = 0; i < slot_count; ++i) {
+			int chip;
+			if(fscanf(f, "%d", &chip) != 1 || chip < 0 || chip > 0xff)
+				break;
+			if(layout != NULL) {
+				const position_t pos = layout_position(layout, i);
+				board_set(board, &pos, (chip_t) chip);
+			}
+		}
+		if(i < slot_count)
+			break;
+
+		if(layout != NULL) {
+			board_init_free_set(board);
+			if(full_pile(board))
+				result += deal_pool_put(pool, board, seed);
+		}
+	}
+
+	free(board);
+	return result;
+}
+
+void deal_pool_write(deal_pool_t *pool, FILE *f)
+{
+	int i, j, k;
+
+	pthread_mutex_lock(&pool->mutex);
+	for(i = 0; i < pool->entry_count; ++i) {
+		const deal_pool_entry_t *entry = &pool->entry[i];
+		for(j = 0; j < entry->count; ++j) {
+			const board_t *board = &entry->deal[j];
+			fprintf(f, "%u %u %d", entry->hash, entry->seed[j], board->layout->slot_count);
+			for(k = 0; k < board->layout->slot_count; ++k)
+				fprintf(f, " %d", board->chip[k]);
+			fprintf(f, "\n");
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,38 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdio.h>
+#include "board.h"
+#include "session.h"
+#include "pool.h"
+
+/*
+	Map files hold the board size, optionally followed by the number of
+	chips (144 if missing), the positions of all chips and then any number
+	of blocker positions, one "x y z" triple per line.
+	Returns 0 on malformed maps, the map is left for map_free() either way.
+*/
+int map_read(map_t *map, FILE *f);
+/* Writes a map for map_read(), leaving out the number of chips of a full set */
+void map_write(const map_t *map, FILE *f);
+/* Frees what map_read() and map_layout() allocated, not the map itself */
+void map_free(map_t *map);
+
+/*
+	Saved games hold the board size and the number of chips on the board,
+	then these chips and the undo log as "y x z chip" lines, two per move.
+	Games saved with the chip of every cell of the grid instead can still
+	be read.
+*/
+int session_read(game_session_t *session, FILE *f);
+void session_write(const game_session_t *session, FILE *f);
+
+/*
+	Pool files hold one deal per line: the layout hash, the seed, the slot
+	count and the chip of every slot. Deals for maps the pool doesn't know or that
+	don't hold the full pile are skipped, returns the number of deals read.
+*/
+int deal_pool_read(deal_pool_t *pool, FILE *f);
+void deal_pool_write(deal_pool_t *pool, FILE *f);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+	Writes procedural layouts as .map files for curating a catalog.
+
+	pb-mahjong-mapgen [-n count] [-t tiles] [-s seed] [-w cols] [-r rows]
+	                  [-z levels] [-l] [-o directory]
+
+	Layout i is made from seed + i, so a catalog can be made again or
+	extended. Files are named after the layout hash, layouts that came out
+	before are skipped. -l makes layouts symmetric from left to right only.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "mapgen.h"
+#include "storage.h"
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pb-mahjong-mapgen [-n count] [-t tiles] [-s seed] [-w cols] [-r rows] [-z levels] [-l] [-o directory]\n");
+	exit(2);
+}
+
+/* Open addressing set of the layout hashes written so far */
+typedef struct {
+	unsigned int *hash;
+	unsigned char *used;
+	int size;
+} hash_set_t;
+
+static int hash_set_add(hash_set_t *set, unsigned int hash)
+{
+	int i = hash % set->size;
+
+	while(set->used[i]) {
+		if(set->hash[i] == hash)
+			return 0;
+		i = (i + 1) % set->size;
+	}
+	set->hash[i] = hash;
+	set->used[i] = 1;
+	return 1;
+}
+
+/* The file has to read back as the same layout */
+static int check_file(const char *path, unsigned int hash)
+{
+	int result;
+	map_t map;
+	FILE *f = fopen(path, "r");
+
+	if(!f)
+		return 0;
+	memset(&map, 0, sizeof(map_t));
+	result = map_read(&map, f) && map_layout(&map) != NULL && layout_hash(map.layout) == hash;
+	fclose(f);
+	map_free(&map);
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i;
+	int count = 1;
+	int tiles = CHIP_COUNT;
+	int col_count = 0, row_count = 0, max_height = 0;
+	int mirror_rows = 1;
+	int written = 0, duplicates = 0, failed = 0;
+	long attempts = 0, stuck = 0, not_dealable = 0;
+	uint32_t seed = (uint32_t) time(NULL);
+	const char *directory = ".";
+	mapgen_options_t options;
+	hash_set_t seen;
+	double t0;
+
+	while((opt = getopt(argc, argv, "n:t:s:w:r:z:lo:")) != -1) {
+		switch(opt) {
+			case 'n': count = atoi(optarg); break;
+			case 't': tiles = atoi(optarg); break;
+			case 's': seed = (uint32_t) strtoul(optarg, NULL, 0); break;
+			case 'w': col_count = atoi(optarg); break;
+			case 'r': row_count = atoi(optarg); break;
+			case 'z': max_height = atoi(optarg); break;
+			case 'l': mirror_rows = 0; break;
+			case 'o': directory = optarg; break;
+			default: usage();
+		}
+	}
+	if(optind != argc || count < 1)
+		usage();
+
+	mapgen_default_options(&options, tiles);
+	if(col_count)
+		options.col_count = col_count;
+	if(row_count)
+		options.row_count = row_count;
+	if(max_height)
+		options.max_height = max_height;
+	options.mirror_rows = mirror_rows;
+
+	seen.size = 2 * count + 1;
+	seen.hash = (unsigned int *) malloc(sizeof(unsigned int) * seen.size);
+	seen.used = (unsigned char *) calloc(seen.size, 1);
+
+	t0 = now();
+	for(i = 0; i < count; ++i) {
+		map_t map;
+		mapgen_stats_t stats;
+		unsigned int hash;
+		char path[1024];
+		FILE *f;
+
+		const int result = generate_map(&map, seed + i, &options, &stats);
+		attempts += stats.attempts;
+		stuck += stats.stuck;
+		not_dealable += stats.not_dealable;
+		if(!result) {
+			++failed;
+			continue;
+		}
+
+		hash = layout_hash(map.layout);
+		if(!hash_set_add(&seen, hash)) {
+			++duplicates;
+			map_free(&map);
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/Generated %08x.map", directory, hash);
+		f = fopen(path, "w");
+		if(!f) {
+			perror(path);
+			return 1;
+		}
+		map_write(&map, f);
+		fclose(f);
+		map_free(&map);
+
+		if(!check_file(path, hash)) {
+			fprintf(stderr, "%s does not read back as the same layout\n", path);
+			return 1;
+		}
+		++written;
+	}
+
+	{
+		const double t = now() - t0;
+		printf("%d layouts of %d tiles written in %.2f s (%.0f per minute), %d duplicates, %d failed\n",
+			written, options.chip_count, t, written * 60 / t, duplicates, failed);
+		printf("%ld attempts, %ld ran out of room, %ld could not be dealt\n", attempts, stuck, not_dealable);
+	}
+
+	free(seen.hash);
+	free(seen.used);
+	return failed == count;
+}
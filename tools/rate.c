@@ -0,0 +1,195 @@
+/*
+	Rates how hard deals are by the share of random or greedy games won.
+
+	pb-mahjong-rate [-m map]... [-n games] [-j threads] [-p random|greedy]
+	                [-s seed] [-d deals] [saved-game | deal-id]...
+
+	Each game or deal ID is looked up among the built-in maps and the maps
+	given with -m, and rated from where it stands. -d rates that many new
+	deals of every difficulty on each map instead, made from seed + i, to
+	calibrate the maps and the difficulties against each other.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "rater.h"
+#include "session.h"
+#include "storage.h"
+
+#define MAX_MAPS 16
+
+static const char *policy_name[RATER_POLICY_COUNT] = { "random", "greedy" };
+static const char *difficulty_name[DIFFICULTY_COUNT] = { "normal", "easy", "hard" };
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pb-mahjong-rate [-m map]... [-n games] [-j threads] [-p random|greedy] [-s seed] [-d deals] [saved-game | deal-id]...\n");
+	exit(2);
+}
+
+static map_t *maps[MAX_MAPS];
+static int map_count;
+
+static void add_map_file(const char *path)
+{
+	int ok;
+	map_t *map;
+	FILE *f = fopen(path, "r");
+
+	if(!f) {
+		perror(path);
+		exit(2);
+	}
+	map = (map_t *) calloc(1, sizeof(map_t));
+	ok = map_read(map, f) && map_layout(map) != NULL;
+	fclose(f);
+	if(!ok || map_count == MAX_MAPS) {
+		fprintf(stderr, "%s: %s\n", path, ok ? "too many maps" : "invalid map");
+		exit(2);
+	}
+	map->name = strdup(path);
+	maps[map_count++] = map;
+}
+
+static map_t *find_map(uint32_t hash)
+{
+	int i;
+
+	for(i = 0; i < map_count; ++i)
+		if(map_layout(maps[i]) != NULL && layout_hash(map_layout(maps[i])) == hash)
+			return maps[i];
+	return NULL;
+}
+
+static int load_game(const char *arg, game_session_t *session)
+{
+	deal_id_t id;
+	FILE *f;
+	int ok;
+
+	if(deal_id_parse(arg, &id)) {
+		map_t *map = find_map(id.layout_hash);
+
+		if(map == NULL) {
+			fprintf(stderr, "%s: no map with layout %08x, add it with -m\n", arg, id.layout_hash);
+			return 0;
+		}
+		if(!session_replay_deal(session, map, &id)) {
+			fprintf(stderr, "%s: the deal could not be made\n", arg);
+			return 0;
+		}
+		return 1;
+	}
+
+	f = fopen(arg, "r");
+	if(!f) {
+		perror(arg);
+		return 0;
+	}
+	ok = session_read(session, f);
+	fclose(f);
+	if(!ok)
+		fprintf(stderr, "%s: not a saved game\n", arg);
+	return ok;
+}
+
+static void print_rating(const char *name, const rating_t *rating)
+{
+	printf("%-24s won %5d of %5d  %5.1f%% (%5.1f ... %5.1f%%)  %5.1f tiles left  %6.3f s\n",
+		name, rating->won, rating->games, rating->win_rate * 100, rating->low * 100, rating->high * 100,
+		rating->tiles_left, rating->seconds);
+}
+
+/* Rates new deals of every difficulty on each map, returns 0 if a deal could not be made */
+static int calibrate(int deals, rater_policy_t policy, int games, int thread_count, uint32_t seed)
+{
+	int m, d, i;
+	board_t board;
+	rating_t rating;
+	char id_text[DEAL_ID_LENGTH + 1];
+
+	for(m = 0; m < map_count; ++m) {
+		for(d = 0; d < DIFFICULTY_COUNT; ++d) {
+			double sum = 0, lowest = 1, highest = 0, seconds = 0;
+
+			for(i = 0; i < deals; ++i) {
+				deal_id_t id = make_deal_id(maps[m], seed + i, d);
+
+				if(!generate_deal(&board, maps[m], &id)) {
+					fprintf(stderr, "%s: no deal from seed %u\n", maps[m]->name, seed + i);
+					return 0;
+				}
+				rate_board(&board, policy, games, thread_count, id.seed, &rating);
+				deal_id_format(&id, id_text);
+				print_rating(id_text, &rating);
+				sum += rating.win_rate;
+				seconds += rating.seconds;
+				if(rating.win_rate < lowest)
+					lowest = rating.win_rate;
+				if(rating.win_rate > highest)
+					highest = rating.win_rate;
+			}
+			printf("%s, %s: mean %5.1f%%, lowest %5.1f%%, highest %5.1f%%, %.3f s per deal\n\n",
+				maps[m]->name, difficulty_name[d], sum * 100 / deals, lowest * 100, highest * 100, seconds / deals);
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i;
+	int games = RATER_DEFAULT_GAMES;
+	int thread_count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int deals = 0;
+	uint32_t seed = 1;
+	rater_policy_t policy = RATER_RANDOM;
+	rating_t rating;
+	game_session_t *session;
+	int status = 0;
+
+	maps[map_count++] = &standard_map;
+	maps[map_count++] = &difficult_map;
+	maps[map_count++] = &four_bridges_map;
+
+	while((opt = getopt(argc, argv, "m:n:j:p:s:d:")) != -1) {
+		switch(opt) {
+			case 'm': add_map_file(optarg); break;
+			case 'n': games = atoi(optarg); break;
+			case 'j': thread_count = atoi(optarg); break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			case 'd': deals = atoi(optarg); break;
+			case 'p':
+				for(policy = 0; policy < RATER_POLICY_COUNT && strcmp(optarg, policy_name[policy]); ++policy)
+					;
+				if(policy == RATER_POLICY_COUNT)
+					usage();
+				break;
+			default: usage();
+		}
+	}
+	if(games <= 0 || (deals <= 0 && optind == argc))
+		usage();
+	if(thread_count < 1)
+		thread_count = 1;
+
+	printf("%d %s games on %d threads\n", games, policy_name[policy], thread_count);
+	if(deals > 0)
+		return calibrate(deals, policy, games, thread_count, seed) ? 0 : 1;
+
+	session = session_create();
+	for(i = optind; i < argc; ++i) {
+		if(!load_game(argv[i], session)) {
+			status = 2;
+			continue;
+		}
+		rate_board(&session->board, policy, games, thread_count, seed, &rating);
+		print_rating(argv[i], &rating);
+	}
+	session_destroy(session);
+	return status;
+}
@@ -0,0 +1,162 @@
+/*
+	Tells whether a game can still be won, with a winning line if it can.
+
+	pb-mahjong-solve [-m map]... [-n nodes] [-t seconds] [-b table_bits]
+	                 [-j threads] saved-game | deal-id
+
+	The game is either a saved game such as pb-mahjong.saved-game or a
+	deal ID, which is looked up among the built-in maps and the maps given
+	with -m. -j searches on several threads sharing one table. Exits with
+	0 if the game can be won, 1 if it can't and 3 if the limits ran out
+	first.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "board.h"
+#include "common.h"
+#include "layout.h"
+#include "maps.h"
+#include "session.h"
+#include "solver.h"
+#include "storage.h"
+
+#define MAX_MAPS 16
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pb-mahjong-solve [-m map]... [-n nodes] [-t seconds] [-b table_bits] [-j threads] saved-game | deal-id\n");
+	exit(2);
+}
+
+static map_t *maps[MAX_MAPS];
+static int map_count;
+
+static void add_map_file(const char *path)
+{
+	int ok;
+	map_t *map;
+	FILE *f = fopen(path, "r");
+
+	if(!f) {
+		perror(path);
+		exit(2);
+	}
+	map = (map_t *) calloc(1, sizeof(map_t));
+	ok = map_read(map, f) && map_layout(map) != NULL;
+	fclose(f);
+	if(!ok || map_count == MAX_MAPS) {
+		fprintf(stderr, "%s: %s\n", path, ok ? "too many maps" : "invalid map");
+		exit(2);
+	}
+	map->name = strdup(path);
+	maps[map_count++] = map;
+}
+
+static map_t *find_map(uint32_t hash)
+{
+	int i;
+
+	for(i = 0; i < map_count; ++i)
+		if(map_layout(maps[i]) != NULL && layout_hash(map_layout(maps[i])) == hash)
+			return maps[i];
+	return NULL;
+}
+
+static int load_game(const char *arg, game_session_t *session)
+{
+	deal_id_t id;
+	FILE *f;
+	int ok;
+
+	if(deal_id_parse(arg, &id)) {
+		map_t *map = find_map(id.layout_hash);
+
+		if(map == NULL) {
+			fprintf(stderr, "%s: no map with layout %08x, add it with -m\n", arg, id.layout_hash);
+			return 0;
+		}
+		if(!session_replay_deal(session, map, &id)) {
+			fprintf(stderr, "%s: the deal could not be made\n", arg);
+			return 0;
+		}
+		printf("Deal %s on %s\n", arg, map->name);
+		return 1;
+	}
+
+	f = fopen(arg, "r");
+	if(!f) {
+		perror(arg);
+		return 0;
+	}
+	ok = session_read(session, f);
+	fclose(f);
+	if(!ok)
+		fprintf(stderr, "%s: not a saved game\n", arg);
+	else
+		printf("Saved game %s, %d tiles left after %d moves\n", arg, session->board.tile_count, session->undo_count);
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i, result;
+	int table_bits = SOLVER_DEFAULT_TABLE_BITS;
+	int thread_count = 1;
+	solver_limits_t limits = { 0, 0, NULL };
+	solver_stats_t stats;
+	move_t line[MAX_CHIP_COUNT / 2];
+	game_session_t *session;
+	solver_t *solver;
+	const board_t *board;
+
+	maps[map_count++] = &standard_map;
+	maps[map_count++] = &difficult_map;
+	maps[map_count++] = &four_bridges_map;
+
+	while((opt = getopt(argc, argv, "m:n:t:b:j:")) != -1) {
+		switch(opt) {
+			case 'm': add_map_file(optarg); break;
+			case 'n': limits.node_limit = atol(optarg); break;
+			case 't': limits.time_limit = atof(optarg); break;
+			case 'b': table_bits = atoi(optarg); break;
+			case 'j': thread_count = atoi(optarg); break;
+			default: usage();
+		}
+	}
+	if(optind != argc - 1)
+		usage();
+
+	session = session_create();
+	if(!load_game(argv[optind], session))
+		return 2;
+	board = &session->board;
+
+	solver = solver_create(table_bits);
+	if(solver == NULL) {
+		fprintf(stderr, "no room for a table of 2^%d positions\n", table_bits);
+		return 2;
+	}
+	result = solve_board_parallel(solver, board, thread_count, &limits, line, &stats);
+
+	if(result == 1) {
+		printf("Solvable, winning line of %d moves (x y z of both tiles):\n", board->tile_count / 2);
+		for(i = 0; i < board->tile_count / 2; ++i) {
+			const position_t a = layout_position(board->layout, line[i].slot1);
+			const position_t b = layout_position(board->layout, line[i].slot2);
+			printf("%3d: %2d %2d %d  %2d %2d %d\n", i + 1, a.x, a.y, a.z, b.x, b.y, b.z);
+		}
+	}
+	else if(result == 0) {
+		printf("Unsolvable\n");
+	}
+	else {
+		printf("Unknown, the limits ran out\n");
+	}
+	printf("%ld nodes in %.3f s, %.0f nodes per second, %ld table hits, %ld deadlocks\n",
+		stats.nodes, stats.seconds, stats.seconds > 0 ? stats.nodes / stats.seconds : 0, stats.table_hits, stats.deadlocks);
+
+	solver_free(solver);
+	session_destroy(session);
+	return result == 1 ? 0 : result == 0 ? 1 : 3;
+}